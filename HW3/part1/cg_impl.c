@@ -1,9 +1,159 @@
 #include "cg_impl.h"
 #include <omp.h>
 
+#ifdef SPMV_SELL
+#include <string.h>
+#include <immintrin.h>
+
+//---------------------------------------------------------------------
+// Row sums of SELL chunk c against v: out[l] = A(row of lane l, :) . v
+// Lanes are rows, so one vector step gathers the k-th entry of all
+// SELL_C rows; each row still adds its entries in CSR order, and the
+// zero padding leaves its sum unchanged.
+//---------------------------------------------------------------------
+static inline void sell_chunk_spmv(int c, const double v[], double out[SELL_C])
+{
+    const int *col = sell_col + sell_start[c];
+    const double *val = sell_val + sell_start[c];
+    int k, width = sell_width[c];
+
+#if defined(__AVX512F__)
+    __m512d acc = _mm512_setzero_pd();
+    for (k = 0; k < width; k++)
+    {
+        __m256i idx = _mm256_load_si256((const __m256i *)(col + k * SELL_C));
+        __m512d x = _mm512_i32gather_pd(idx, v, 8);
+        acc = _mm512_add_pd(acc, _mm512_mul_pd(_mm512_load_pd(val + k * SELL_C), x));
+    }
+    _mm512_storeu_pd(out, acc);
+#elif defined(__AVX2__)
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    for (k = 0; k < width; k++)
+    {
+        __m128i idx0 = _mm_load_si128((const __m128i *)(col + k * SELL_C));
+        __m128i idx1 = _mm_load_si128((const __m128i *)(col + k * SELL_C + 4));
+        __m256d x0 = _mm256_i32gather_pd(v, idx0, 8);
+        __m256d x1 = _mm256_i32gather_pd(v, idx1, 8);
+        acc0 = _mm256_add_pd(acc0, _mm256_mul_pd(_mm256_load_pd(val + k * SELL_C), x0));
+        acc1 = _mm256_add_pd(acc1, _mm256_mul_pd(_mm256_load_pd(val + k * SELL_C + 4), x1));
+    }
+    _mm256_storeu_pd(out, acc0);
+    _mm256_storeu_pd(out + 4, acc1);
+#else
+    int l;
+    for (l = 0; l < SELL_C; l++)
+        out[l] = 0.0;
+    for (k = 0; k < width; k++)
+    {
+        for (l = 0; l < SELL_C; l++)
+            out[l] = out[l] + val[k * SELL_C + l] * v[col[k * SELL_C + l]];
+    }
+#endif
+}
+
+static int *sell_sort_rowstr;
+
+// longer rows first; ties in row order so the layout is deterministic
+static int sell_compare_rows(const void *pa, const void *pb)
+{
+    int ra = *(const int *)pa, rb = *(const int *)pb;
+    int la = sell_sort_rowstr[ra + 1] - sell_sort_rowstr[ra];
+    int lb = sell_sort_rowstr[rb + 1] - sell_sort_rowstr[rb];
+    if (la != lb)
+        return lb - la;
+    return ra - rb;
+}
+
+//---------------------------------------------------------------------
+// Builds the SELL-C-sigma copy (sell_*) of the CSR matrix
+// rowstr/colidx/a of nrows rows.  Chunks are filled by the threads and
+// schedule that later multiply them.
+//---------------------------------------------------------------------
+void sell_build(int nrows, int rowstr[], int colidx[], double a[])
+{
+    int i, c, w;
+    int *order = (int *)malloc(sizeof(int) * SELL_CHUNKS * SELL_C);
+
+    for (i = 0; i < nrows; i++)
+        order[i] = i;
+    for (; i < SELL_CHUNKS * SELL_C; i++)
+        order[i] = -1;
+
+    sell_sort_rowstr = rowstr;
+    for (w = 0; w < nrows; w += SELL_SIGMA)
+    {
+        int len = (nrows - w < SELL_SIGMA) ? nrows - w : SELL_SIGMA;
+        qsort(order + w, len, sizeof(int), sell_compare_rows);
+    }
+
+    sell_start[0] = 0;
+    for (c = 0; c < SELL_CHUNKS; c++)
+    {
+        int l, width = 0;
+        for (l = 0; l < SELL_C; l++)
+        {
+            int row = order[c * SELL_C + l];
+            sell_row[c * SELL_C + l] = row;
+            if (row >= 0 && rowstr[row + 1] - rowstr[row] > width)
+                width = rowstr[row + 1] - rowstr[row];
+        }
+        sell_width[c] = width;
+        sell_start[c + 1] = sell_start[c] + width * SELL_C;
+    }
+    free(order);
+
+    // sell_start[] entries are multiples of SELL_C, so every column of
+    // a chunk stays 64-byte aligned
+    size_t entries = (size_t)sell_start[SELL_CHUNKS] + SELL_C;
+    sell_col = (int *)aligned_alloc(64, (entries * sizeof(int) + 63) / 64 * 64);
+    sell_val = (double *)aligned_alloc(64, entries * sizeof(double));
+
+    #pragma omp parallel for
+    for (c = 0; c < SELL_CHUNKS; c++)
+    {
+        int k, l;
+        for (k = 0; k < sell_width[c]; k++)
+        {
+            for (l = 0; l < SELL_C; l++)
+            {
+                int row = sell_row[c * SELL_C + l];
+                int at = sell_start[c] + k * SELL_C + l;
+                if (row >= 0 && k < rowstr[row + 1] - rowstr[row])
+                {
+                    sell_col[at] = colidx[rowstr[row] + k];
+                    sell_val[at] = a[rowstr[row] + k];
+                }
+                else
+                {
+                    sell_col[at] = 0;
+                    sell_val[at] = 0.0;
+                }
+            }
+        }
+    }
+}
+#endif
+
 //---------------------------------------------------------------------
 // Floaging point arrays here are named as in spec discussion of
 // CG algorithm
+//
+// The whole routine runs in one parallel region: every vector loop is
+// a worksharing loop of the same team, so an iteration costs a few
+// barriers instead of a fork/join per loop.  Reductions combine into
+// shared scalars (d, rho_next, sum).  A reduction may combine before its
+// loop's closing barrier, so each scalar is reset by one thread in a
+// phase that ends in a barrier before the loop reducing into it, and
+// after every thread has read its previous value: rho_next at the top
+// of the iteration (it is reduced after the SpMV), d during the p
+// update (it is reduced in the next SpMV and read before the z/r
+// update's barrier).
+//
+// Each iteration makes three passes over the vectors: the SpMV also
+// forms p.q from the q[j] it just computed, the z/r update also forms
+// r.r, and the p update.  This relies on the matrix being square
+// (rows and columns both cover 0 .. naa-1).
 //---------------------------------------------------------------------
 void conj_grad(int colidx[],
                int rowstr[],
@@ -15,145 +165,235 @@ void conj_grad(int colidx[],
                double r[],
                double *rnorm)
 {
-    int j, k;
-    int cgit, cgitmax = 25;
-    double d, sum, rho, rho0, alpha, beta;
+    int cgitmax = 25;
+    double d, rho, rho_next, sum;
 
+    d = 0.0;
     rho = 0.0;
+    rho_next = 0.0;
+    sum = 0.0;
 
-    //---------------------------------------------------------------------
-    // Initialize the CG algorithm:
-    //---------------------------------------------------------------------
-    // #pragma omp parallel for
-    for (j = 0; j < naa + 1; j++)
-    {
-        q[j] = 0.0;
-        z[j] = 0.0;
-        r[j] = x[j];
-        p[j] = r[j];
-    }
-
-    //---------------------------------------------------------------------
-    // rho = r.r
-    // Now, obtain the norm of r: First, sum squares of r elements locally...
-    //---------------------------------------------------------------------
-    #pragma omp parallel for reduction(+:rho)
-    for (j = 0; j < lastcol - firstcol + 1; j++)
+    #pragma omp parallel
     {
-        rho = rho + r[j] * r[j];
-    }
+        int j, k, cgit;
+        double alpha, beta;
 
-    //---------------------------------------------------------------------
-    //---->
-    // The conj grad iteration loop
-    //---->
-    //---------------------------------------------------------------------
-    // #pragma omp parallel for ordered
-    for (cgit = 1; cgit <= cgitmax; cgit++)
-    {
         //---------------------------------------------------------------------
-        // q = A.p
-        // The partition submatrix-vector multiply: use workspace w
+        // Initialize the CG algorithm:
         //---------------------------------------------------------------------
-        //
-        // NOTE: this version of the multiply is actually (slightly: maybe %5)
-        //       faster on the sp2 on 16 nodes than is the unrolled-by-2 version
-        //       below.   On the Cray t3d, the reverse is true, i.e., the
-        //       unrolled-by-two version is some 10% faster.
-        //       The unrolled-by-8 version below is significantly faster
-        //       on the Cray t3d - overall speed of code is 1.5 times faster.
-        #pragma omp parallel for private(sum)
-        for (j = 0; j < lastrow - firstrow + 1; j++)
+        #pragma omp for
+        for (j = 0; j < naa + 1; j++)
         {
-            sum = 0.0;
-            // #pragma omp for reduction(+:sum)
-            for (k = rowstr[j]; k < rowstr[j + 1]; k++)
-            {
-                sum = sum + a[k] * p[colidx[k]];
-            }
-            q[j] = sum;
+            q[j] = 0.0;
+            z[j] = 0.0;
+            r[j] = x[j];
+            p[j] = r[j];
         }
 
         //---------------------------------------------------------------------
-        // Obtain p.q
+        // rho = r.r
+        // Now, obtain the norm of r: First, sum squares of r elements locally...
+        // (summed into rho_next, which the loop below moves to rho)
         //---------------------------------------------------------------------
-        d = 0.0;
+        #pragma omp for reduction(+:rho_next)
         for (j = 0; j < lastcol - firstcol + 1; j++)
         {
-            d = d + p[j] * q[j];
+            rho_next = rho_next + r[j] * r[j];
         }
 
         //---------------------------------------------------------------------
-        // Obtain alpha = rho / (p.q)
+        //---->
+        // The conj grad iteration loop
+        //---->
         //---------------------------------------------------------------------
-        alpha = rho / d;
+        for (cgit = 1; cgit <= cgitmax; cgit++)
+        {
+            //---------------------------------------------------------------------
+            // Save a temporary of rho: rho holds the old r.r for the rest
+            // of the iteration and rho_next collects the new one
+            //---------------------------------------------------------------------
+            #pragma omp single nowait
+            {
+                rho = rho_next;
+                rho_next = 0.0;
+            }
 
-        //---------------------------------------------------------------------
-        // Save a temporary of rho
-        //---------------------------------------------------------------------
-        rho0 = rho;
+            //---------------------------------------------------------------------
+            // q = A.p
+            // The partition submatrix-vector multiply: use workspace w
+            //---------------------------------------------------------------------
+            //
+            // NOTE: this version of the multiply is actually (slightly: maybe %5)
+            //       faster on the sp2 on 16 nodes than is the unrolled-by-2 version
+            //       below.   On the Cray t3d, the reverse is true, i.e., the
+            //       unrolled-by-two version is some 10% faster.
+            //       The unrolled-by-8 version below is significantly faster
+            //       on the Cray t3d - overall speed of code is 1.5 times faster.
+            //
+            // Obtain p.q in the same pass
+#ifdef SPMV_SELL
+            #pragma omp for reduction(+:d)
+            for (j = 0; j < SELL_CHUNKS; j++)
+            {
+                double row_sums[SELL_C];
+                sell_chunk_spmv(j, p, row_sums);
+                for (k = 0; k < SELL_C; k++)
+                {
+                    int row = sell_row[j * SELL_C + k];
+                    if (row >= 0)
+                    {
+                        q[row] = row_sums[k];
+                        d = d + p[row] * row_sums[k];
+                    }
+                }
+            }
+#else
+            #pragma omp for reduction(+:d)
+            for (j = 0; j < lastrow - firstrow + 1; j++)
+            {
+                double row_sum = 0.0;
+                for (k = rowstr[j]; k < rowstr[j + 1]; k++)
+                {
+                    row_sum = row_sum + a[k] * p[colidx[k]];
+                }
+                q[j] = row_sum;
+                d = d + p[j] * row_sum;
+            }
+#endif
+
+            //---------------------------------------------------------------------
+            // Obtain alpha = rho / (p.q)
+            //---------------------------------------------------------------------
+            alpha = rho / d;
+
+            //---------------------------------------------------------------------
+            // Obtain z = z + alpha*p
+            // and    r = r - alpha*q
+            // and    rho = r.r from the updated r[j]
+            //---------------------------------------------------------------------
+            #pragma omp for reduction(+:rho_next)
+            for (j = 0; j < lastcol - firstcol + 1; j++)
+            {
+                double rj = r[j] - alpha * q[j];
+                z[j] = z[j] + alpha * p[j];
+                r[j] = rj;
+                rho_next = rho_next + rj * rj;
+            }
+
+            //---------------------------------------------------------------------
+            // Obtain beta:
+            //---------------------------------------------------------------------
+            beta = rho_next / rho;
+
+            //---------------------------------------------------------------------
+            // p = r + beta*p
+            // (d is reset here, where the loop's barrier orders it before
+            // the next SpMV combines into it)
+            //---------------------------------------------------------------------
+            #pragma omp single nowait
+            d = 0.0;
+
+            #pragma omp for
+            for (j = 0; j < lastcol - firstcol + 1; j++)
+            {
+                p[j] = r[j] + beta * p[j];
+            }
+        } // end of do cgit=1,cgitmax
 
         //---------------------------------------------------------------------
-        // Obtain z = z + alpha*p
-        // and    r = r - alpha*q
+        // Compute residual norm explicitly:  ||r|| = ||x - A.z||
+        // First, form A.z
+        // The partition submatrix-vector multiply
         //---------------------------------------------------------------------
-        rho = 0.0;
-        for (j = 0; j < lastcol - firstcol + 1; j++)
+#ifdef SPMV_SELL
+        #pragma omp for
+        for (j = 0; j < SELL_CHUNKS; j++)
+        {
+            double row_sums[SELL_C];
+            sell_chunk_spmv(j, z, row_sums);
+            for (k = 0; k < SELL_C; k++)
+            {
+                if (sell_row[j * SELL_C + k] >= 0)
+                    r[sell_row[j * SELL_C + k]] = row_sums[k];
+            }
+        }
+#else
+        #pragma omp for
+        for (j = 0; j < lastrow - firstrow + 1; j++)
         {
-            z[j] = z[j] + alpha * p[j];
-            r[j] = r[j] - alpha * q[j];
+            double row_sum = 0.0;
+            for (k = rowstr[j]; k < rowstr[j + 1]; k++)
+            {
+                row_sum = row_sum + a[k] * z[colidx[k]];
+            }
+            r[j] = row_sum;
         }
+#endif
 
         //---------------------------------------------------------------------
-        // rho = r.r
-        // Now, obtain the norm of r: First, sum squares of r elements locally...
+        // At this point, r contains A.z
         //---------------------------------------------------------------------
-        #pragma omp parallel for reduction(+:rho)
+        #pragma omp for reduction(+:sum)
         for (j = 0; j < lastcol - firstcol + 1; j++)
         {
-            rho = rho + r[j] * r[j];
+            double diff = x[j] - r[j];
+            sum = sum + diff * diff;
         }
+    }
 
-        //---------------------------------------------------------------------
-        // Obtain beta:
-        //---------------------------------------------------------------------
-        beta = rho / rho0;
+    *rnorm = sqrt(sum);
+}
 
-        //---------------------------------------------------------------------
-        // p = r + beta*p
-        //---------------------------------------------------------------------
-        for (j = 0; j < lastcol - firstcol + 1; j++)
-        {
-            p[j] = r[j] + beta * p[j];
-        }
-    } // end of do cgit=1,cgitmax
+//---------------------------------------------------------------------
+// makea draws the randlc sequence of tran/amult through this buffer.
+// Every refill generates the next RANDOM_BATCH values in parallel, each
+// thread jumping to its own piece with randlc_skip, so the values are
+// exactly the ones successive randlc calls would return.
+//---------------------------------------------------------------------
+#define RANDOM_BATCH (1 << 18)
 
-    //---------------------------------------------------------------------
-    // Compute residual norm explicitly:  ||r|| = ||x - A.z||
-    // First, form A.z
-    // The partition submatrix-vector multiply
-    //---------------------------------------------------------------------
-    sum = 0.0;
-    for (j = 0; j < lastrow - firstrow + 1; j++)
+static double random_batch[RANDOM_BATCH];
+static double random_seed;
+static int random_pos, random_len;
+
+static void random_refill(void)
+{
+    random_seed = tran;
+
+    #pragma omp parallel
     {
-        d = 0.0;
-        for (k = rowstr[j]; k < rowstr[j + 1]; k++)
-        {
-            d = d + a[k] * z[colidx[k]];
-        }
-        r[j] = d;
+        int t = omp_get_thread_num();
+        int nt = omp_get_num_threads();
+        int begin = (int)((long)RANDOM_BATCH * t / nt);
+        int end = (int)((long)RANDOM_BATCH * (t + 1) / nt);
+        double x = random_seed;
+
+        randlc_skip(&x, amult, begin);
+        vranlc(end - begin, &x, amult, random_batch + begin);
     }
 
-    //---------------------------------------------------------------------
-    // At this point, r contains A.z
-    //---------------------------------------------------------------------
-    for (j = 0; j < lastcol - firstcol + 1; j++)
+    randlc_skip(&tran, amult, RANDOM_BATCH);
+    random_pos = 0;
+    random_len = RANDOM_BATCH;
+}
+
+static inline double random_next(void)
+{
+    if (random_pos == random_len)
+        random_refill();
+    return random_batch[random_pos++];
+}
+
+// Leaves tran just past the last value handed out, as if every value
+// had come from randlc directly.
+static void random_release(void)
+{
+    if (random_len > 0)
     {
-        d = x[j] - r[j];
-        sum = sum + d * d;
+        tran = random_seed;
+        randlc_skip(&tran, amult, random_pos);
     }
-
-    *rnorm = sqrt(sum);
+    random_pos = random_len = 0;
 }
 
 //---------------------------------------------------------------------
@@ -214,21 +454,24 @@ void makea(int n,
 
     //---------------------------------------------------------------------
     // Generate nonzero positions and save for the use in sparse.
+    // The number of random values an outer vector consumes depends on
+    // the values, so the vectors are picked serially; the random values
+    // themselves are generated in parallel batches (see random_refill).
     //---------------------------------------------------------------------
-    // #pragma omp parallel for ordered
+    random_pos = random_len = 0;
     for (iouter = 0; iouter < n; iouter++)
     {
         nzv = NONZER;
         sprnvc(n, nzv, nn1, vc, ivc);
         vecset(n, vc, ivc, &nzv, iouter + 1, 0.5);
         arow[iouter] = nzv;
-        // #pragma omp ordered
         for (ivelt = 0; ivelt < nzv; ivelt++)
         {
             acol[iouter][ivelt] = ivc[ivelt] - 1;
             aelt[iouter][ivelt] = vc[ivelt];
         }
     }
+    random_release();
 
     //---------------------------------------------------------------------
     // ... make the sparse matrix from list of elements with duplicates
@@ -239,9 +482,33 @@ void makea(int n,
            iv, RCOND, SHIFT);
 }
 
+// One [col, value] contribution to a row of the matrix; seq is its
+// position in the serial generation order of that row.
+typedef struct
+{
+    int col;
+    int seq;
+    double val;
+} triple;
+
+static int compare_triples(const void *pa, const void *pb)
+{
+    const triple *ta = (const triple *)pa, *tb = (const triple *)pb;
+    if (ta->col != tb->col)
+        return (ta->col > tb->col) - (ta->col < tb->col);
+    return ta->seq - tb->seq;
+}
+
 //---------------------------------------------------------------------
 // rows range from firstrow to lastrow
 // the rowstr pointers are defined for nrows = lastrow-firstrow+1 values
+//
+// The serial version inserted every triple into its row in place.  Here
+// the outer vectors touching each row are listed first (in generation
+// order), then every row generates its own triples, sorts them by
+// column and sums duplicates in generation order.  Each entry is thus
+// the same sum, in the same order, as the serial insertion produced, so
+// the matrix is bitwise identical, and rows are independent.
 //---------------------------------------------------------------------
 void sparse(double a[],
             int colidx[],
@@ -264,9 +531,12 @@ void sparse(double a[],
     // generate a sparse matrix from a list of
     // [col, row, element] tri
     //---------------------------------------------------
-    int i, j, j1, j2, nza, k, kk, nzrow, jcol;
-    double size, scale, ratio, va;
-    logical cont40;
+    int i, j, nza, max_row;
+    double ratio;
+    int *outer_start, *outer_list;
+    double *size;
+    int *tmp_col;
+    double *tmp_val;
 
     //---------------------------------------------------------------------
     // how many rows of result
@@ -274,8 +544,10 @@ void sparse(double a[],
     nrows = lastrow - firstrow + 1;
 
     //---------------------------------------------------------------------
-    // ...count the number of triples in each row
+    // ...count the number of triples in each row, and the outer vectors
+    //    that contribute to it
     //---------------------------------------------------------------------
+    outer_start = (int *)calloc(nrows + 1, sizeof(int));
     for (j = 0; j < nrows + 1; j++)
     {
         rowstr[j] = 0;
@@ -287,13 +559,18 @@ void sparse(double a[],
         {
             j = acol[i][nza] + 1;
             rowstr[j] = rowstr[j] + arow[i];
+            outer_start[j] = outer_start[j] + 1;
         }
     }
 
     rowstr[0] = 0;
+    max_row = 0;
     for (j = 1; j < nrows + 1; j++)
     {
+        if (rowstr[j] > max_row)
+            max_row = rowstr[j];
         rowstr[j] = rowstr[j] + rowstr[j - 1];
+        outer_start[j] = outer_start[j] + outer_start[j - 1];
     }
     nza = rowstr[nrows] - 1;
 
@@ -309,127 +586,124 @@ void sparse(double a[],
     }
 
     //---------------------------------------------------------------------
-    // ... preload data pages
+    // ... list the (outer vector, position) pairs of every row in
+    //     increasing outer vector order, and the scale of every outer
+    //     vector (size is a running product, so it stays serial)
     //---------------------------------------------------------------------
-    for (j = 0; j < nrows; j++)
+    outer_list = (int *)malloc(sizeof(int) * (outer_start[nrows] + 1));
+    for (i = 0; i < n; i++)
     {
-        for (k = rowstr[j]; k < rowstr[j + 1]; k++)
+        for (nza = 0; nza < arow[i]; nza++)
         {
-            a[k] = 0.0;
-            colidx[k] = -1;
+            j = acol[i][nza];
+            outer_list[outer_start[j]] = i * (NONZER + 1) + nza;
+            outer_start[j] = outer_start[j] + 1;
         }
-        nzloc[j] = 0;
+    }
+    for (j = nrows; j > 0; j--)
+    {
+        outer_start[j] = outer_start[j - 1];
+    }
+    outer_start[0] = 0;
+
+    size = (double *)malloc(sizeof(double) * (n + 1));
+    ratio = pow(rcond, (1.0 / (double)(n)));
+    size[0] = 1.0;
+    for (i = 1; i < n; i++)
+    {
+        size[i] = size[i - 1] * ratio;
     }
 
     //---------------------------------------------------------------------
-    // ... generate actual values by summing duplicates
+    // ... generate actual values by summing duplicates: every row is
+    //     reduced into its own slots of tmp, nzloc gets its length
     //---------------------------------------------------------------------
-    size = 1.0;
-    ratio = pow(rcond, (1.0 / (double)(n)));
+    tmp_col = (int *)malloc(sizeof(int) * (rowstr[nrows] + 1));
+    tmp_val = (double *)malloc(sizeof(double) * (rowstr[nrows] + 1));
 
-    // #pragma omp parallel for ordered
-    for (i = 0; i < n; i++)
+    #pragma omp parallel
     {
-        for (nza = 0; nza < arow[i]; nza++)
-        {
-            j = acol[i][nza];
+        triple *row = (triple *)malloc(sizeof(triple) * (max_row + 1));
+        int t, jj, kk, nzrow, count;
 
-            scale = size * aelt[i][nza];
-            for (nzrow = 0; nzrow < arow[i]; nzrow++)
+        #pragma omp for schedule(dynamic, 64)
+        for (jj = 0; jj < nrows; jj++)
+        {
+            count = 0;
+            for (t = outer_start[jj]; t < outer_start[jj + 1]; t++)
             {
-                jcol = acol[i][nzrow];
-                va = aelt[i][nzrow] * scale;
-
-                //--------------------------------------------------------------------
-                // ... add the identity * rcond to the generated matrix to bound
-                //     the smallest eigenvalue from below by rcond
-                //--------------------------------------------------------------------
-                if (jcol == j && j == i)
+                int ii = outer_list[t] / (NONZER + 1);
+                int pos = outer_list[t] % (NONZER + 1);
+                double scale = size[ii] * aelt[ii][pos];
+                for (nzrow = 0; nzrow < arow[ii]; nzrow++)
                 {
-                    va = va + rcond - shift;
-                }
-
-                cont40 = false;
-                for (k = rowstr[j]; k < rowstr[j + 1]; k++)
-                {
-                    if (colidx[k] > jcol)
+                    int jcol = acol[ii][nzrow];
+                    double va = aelt[ii][nzrow] * scale;
+
+                    //--------------------------------------------------------------------
+                    // ... add the identity * rcond to the generated matrix to bound
+                    //     the smallest eigenvalue from below by rcond
+                    //--------------------------------------------------------------------
+                    if (jcol == jj && jj == ii)
                     {
-                        //----------------------------------------------------------------
-                        // ... insert colidx here orderly
-                        //----------------------------------------------------------------
-                        for (kk = rowstr[j + 1] - 2; kk >= k; kk--)
-                        {
-                            if (colidx[kk] > -1)
-                            {
-                                a[kk + 1] = a[kk];
-                                colidx[kk + 1] = colidx[kk];
-                            }
-                        }
-                        colidx[k] = jcol;
-                        a[k] = 0.0;
-                        cont40 = true;
-                        break;
-                    }
-                    else if (colidx[k] == -1)
-                    {
-                        colidx[k] = jcol;
-                        cont40 = true;
-                        break;
-                    }
-                    else if (colidx[k] == jcol)
-                    {
-                        //--------------------------------------------------------------
-                        // ... mark the duplicated entry
-                        //--------------------------------------------------------------
-                        nzloc[j] = nzloc[j] + 1;
-                        cont40 = true;
-                        break;
+                        va = va + rcond - shift;
                     }
+                    row[count].col = jcol;
+                    row[count].seq = count;
+                    row[count].val = va;
+                    count++;
                 }
-                if (cont40 == false)
+            }
+
+            qsort(row, count, sizeof(triple), compare_triples);
+
+            kk = rowstr[jj] - 1;
+            for (t = 0; t < count; t++)
+            {
+                if (t == 0 || row[t].col != row[t - 1].col)
                 {
-                    printf("internal error in sparse: i=%d\n", i);
-                    exit(EXIT_FAILURE);
+                    kk++;
+                    tmp_col[kk] = row[t].col;
+                    tmp_val[kk] = 0.0;
                 }
-                a[k] = a[k] + va;
+                tmp_val[kk] = tmp_val[kk] + row[t].val;
             }
+            nzloc[jj] = kk + 1 - rowstr[jj];
         }
-        size = size * ratio;
+
+        free(row);
     }
 
     //---------------------------------------------------------------------
     // ... remove empty entries and generate final results
+    //     (nzloc[j] becomes where row j sits in tmp)
     //---------------------------------------------------------------------
-    for (j = 1; j < nrows; j++)
+    nza = 0;
+    for (j = 0; j < nrows; j++)
     {
-        nzloc[j] = nzloc[j] + nzloc[j - 1];
+        i = nzloc[j];
+        nzloc[j] = rowstr[j];
+        rowstr[j] = nza;
+        nza = nza + i;
     }
+    rowstr[nrows] = nza;
 
-    // #pragma omp parallel for
+    #pragma omp parallel for schedule(dynamic, 64)
     for (j = 0; j < nrows; j++)
     {
-        if (j > 0)
-        {
-            j1 = rowstr[j] - nzloc[j - 1];
-        }
-        else
-        {
-            j1 = 0;
-        }
-        j2 = rowstr[j + 1] - nzloc[j];
-        nza = rowstr[j];
-        for (k = j1; k < j2; k++)
+        int k, from = nzloc[j];
+        for (k = rowstr[j]; k < rowstr[j + 1]; k++, from++)
         {
-            a[k] = a[nza];
-            colidx[k] = colidx[nza];
-            nza = nza + 1;
+            a[k] = tmp_val[from];
+            colidx[k] = tmp_col[from];
         }
     }
-    for (j = 1; j < nrows + 1; j++)
-    {
-        rowstr[j] = rowstr[j] - nzloc[j - 1];
-    }
-    nza = rowstr[nrows] - 1;
+
+    free(tmp_val);
+    free(tmp_col);
+    free(size);
+    free(outer_list);
+    free(outer_start);
 }
 
 //---------------------------------------------------------------------
@@ -440,6 +714,9 @@ void sparse(double a[],
 // mark is all zero on entry and is reset to all zero before exit
 // this corrects a performance bug found by John G. Lewis, caused by
 // reinitialization of mark on every one of the n calls to sprnvc
+//
+// The random values come from random_next(), i.e. the randlc sequence
+// of tran/amult as buffered by makea.
 //---------------------------------------------------------------------
 void sprnvc(int n, int nz, int nn1, double v[], int iv[])
 {
@@ -450,12 +727,12 @@ void sprnvc(int n, int nz, int nn1, double v[], int iv[])
 
     while (nzv < nz)
     {
-        vecelt = randlc(&tran, amult);
+        vecelt = random_next();
 
         //---------------------------------------------------------------------
         // generate an integer between 1 and n in a portable manner
         //---------------------------------------------------------------------
-        vecloc = randlc(&tran, amult);
+        vecloc = random_next();
         i = icnvrt(vecloc, nn1) + 1;
         if (i > n)
             continue;
@@ -560,6 +837,10 @@ void init(double *zeta)
         }
     }
 
+#ifdef SPMV_SELL
+    sell_build(lastrow - firstrow + 1, rowstr, colidx, a);
+#endif
+
     //---------------------------------------------------------------------
     // set starting vector to (1, 1, .... 1)
     //---------------------------------------------------------------------
@@ -595,7 +876,7 @@ void iterate(double *zeta, int *it)
     norm_temp1 = 0.0;
     norm_temp2 = 0.0;
 
-    // #pragma omp parallel for reduction(+:norm_temp1, norm_temp2)
+    #pragma omp parallel for reduction(+:norm_temp1, norm_temp2)
     for (j = 0; j < lastcol - firstcol + 1; j++)
     {
         norm_temp1 = norm_temp1 + x[j] * z[j];
@@ -612,7 +893,7 @@ void iterate(double *zeta, int *it)
     //---------------------------------------------------------------------
     // Normalize z to obtain x
     //---------------------------------------------------------------------
-    // #pragma omp parallel for
+    #pragma omp parallel for
     for (j = 0; j < lastcol - firstcol + 1; j++)
     {
         x[j] = norm_temp2 * z[j];
@@ -38,6 +38,26 @@ double tran;
 
 /* common /timers/ */
 logical timeron;
+
+#ifdef SPMV_SELL
+//---------------------------------------------------------------------
+// SELL-C-sigma copy of a/colidx for the CG SpMV (make SPMV=sell).
+// Rows are sorted by length within windows of SELL_SIGMA rows and cut
+// into chunks of SELL_C rows.  Chunk c stores sell_width[c] columns of
+// SELL_C entries each, column-major from sell_start[c], padded with
+// zeros; sell_row[c * SELL_C + l] is the row of its lane l (-1 for the
+// padding lanes of the last chunk).
+//---------------------------------------------------------------------
+#define SELL_C     8
+#define SELL_SIGMA 1024
+#define SELL_CHUNKS ((NA + SELL_C - 1) / SELL_C)
+
+int sell_start[SELL_CHUNKS + 1];
+int sell_width[SELL_CHUNKS];
+int sell_row[SELL_CHUNKS * SELL_C];
+int *sell_col;
+double *sell_val;
+#endif
 //---------------------------------------------------------------------
 
 //---------------------------------------------------------------------
@@ -80,5 +100,8 @@ void sparse(double a[],
 void sprnvc(int n, int nz, int nn1, double v[], int iv[]);
 int icnvrt(double x, int ipwr2);
 void vecset(int n, double v[], int iv[], int *nzv, int i, double val);
+#ifdef SPMV_SELL
+void sell_build(int nrows, int rowstr[], int colidx[], double a[]);
+#endif
 void init(double *zeta);
 void iterate(double *zeta, int *it);
\ No newline at end of file
@@ -68,6 +68,62 @@ double randlc( double *x, double a )
 }
 
 
+double randlc_skip( double *x, double a, long n )
+{
+  //--------------------------------------------------------------------
+  //
+  //  This routine advances the seed X of the generator used by RANDLC by
+  //  N steps at once, i.e. sets X to a^N X (mod 2^46), and returns the
+  //  normalized new seed, the value the N-th of N calls to RANDLC would
+  //  have returned.  a^N is formed by repeated squaring, so the cost is
+  //  O(log N) multiplications, each done exactly by RANDLC itself.
+  //  N = 0 leaves X unchanged.
+  //
+  //  Threads that start from the same X and skip to different N get
+  //  disjoint, deterministic pieces of one sequence.
+  //
+  //--------------------------------------------------------------------
+
+  const double r23 = 1.1920928955078125e-07;
+  const double r46 = r23 * r23;
+
+  double t = a;
+
+  while ( n > 0 ) {
+    if ( n & 1 ) randlc( x, t );
+    n >>= 1;
+    if ( n > 0 ) randlc( &t, t );
+  }
+
+  return r46 * (*x);
+}
+
+
+// One step x <- a x (mod 2^46) of RANDLC with a = 2^23 * a1 + a2
+// already split.
+static inline double lcg_step( double x, double a1, double a2 )
+{
+  const double r23 = 1.1920928955078125e-07;
+  const double r46 = r23 * r23;
+  const double t23 = 8.388608e+06;
+  const double t46 = t23 * t23;
+
+  double t1, t2, t3, t4, x1, x2, z;
+
+  t1 = r23 * x;
+  x1 = (int) t1;
+  x2 = x - t23 * x1;
+  t1 = a1 * x2 + a2 * x1;
+  t2 = (int) (r23 * t1);
+  z = t1 - t23 * t2;
+  t3 = t23 * z + a2 * x2;
+  t4 = (int) (r46 * t3) ;
+  return t3 - t46 * t4;
+}
+
+// Independent seeds advanced in lock step by vranlc.
+#define VRANLC_LANES 8
+
 void vranlc( int n, double *x, double a, double y[] )
 {
   //--------------------------------------------------------------------
@@ -86,10 +142,9 @@ void vranlc( int n, double *x, double a, double y[] )
   //  continuous sequence.  If N is zero, only initialization is performed, and
   //  the variables X, A and Y are ignored.
   //
-  //  This routine is the standard version designed for scalar or RISC systems.
-  //  However, it should produce the same results on any single processor
-  //  computer with at least 48 mantissa bits in double precision floating point
-  //  data.  On 64 bit systems, double precision should be disabled.
+  //  This version interleaves several sequences so the loop vectorizes (see
+  //  below).  It should produce the same results on any computer with at
+  //  least 48 mantissa bits in double precision floating point data.
   //
   //--------------------------------------------------------------------
 
@@ -105,9 +160,10 @@ void vranlc( int n, double *x, double a, double y[] )
   const double t23 = 8.388608e+06;
   const double t46 = t23 * t23;
 
-  double t1, t2, t3, t4, a1, a2, x1, x2, z;
+  double t1, a1, a2, aL1, aL2, aL;
+  double s[VRANLC_LANES];
 
-  int i;
+  int i, l, m;
 
   //--------------------------------------------------------------------
   //  Break A into two parts such that A = 2^23 * A1 + A2.
@@ -117,23 +173,44 @@ void vranlc( int n, double *x, double a, double y[] )
   a2 = a - t23 * a1;
 
   //--------------------------------------------------------------------
-  //  Generate N results.   This loop is not vectorizable.
-  //--------------------------------------------------------------------
-  for ( i = 0; i < n; i++ ) {
-    //--------------------------------------------------------------------
-    //  Break X into two parts such that X = 2^23 * X1 + X2, compute
-    //  Z = A1 * X2 + A2 * X1  (mod 2^23), and then
-    //  X = 2^23 * Z + A2 * X2  (mod 2^46).
-    //--------------------------------------------------------------------
-    t1 = r23 * (*x);
-    x1 = (int) t1;
-    x2 = *x - t23 * x1;
-    t1 = a1 * x2 + a2 * x1;
-    t2 = (int) (r23 * t1);
-    z = t1 - t23 * t2;
-    t3 = t23 * z + a2 * x2;
-    t4 = (int) (r46 * t3) ;
-    *x = t3 - t46 * t4;
+  //  The recurrence itself is not vectorizable, so the results are
+  //  generated as VRANLC_LANES interleaved sequences: lane l starts at
+  //  a^(l+1) X and steps by a^VRANLC_LANES, giving Y(k + l) for every
+  //  k that is a multiple of VRANLC_LANES.  The lanes are independent
+  //  and do the same exact integer arithmetic, so Y is identical to
+  //  the one-at-a-time sequence.
+  //--------------------------------------------------------------------
+  m = ( n >= 2 * VRANLC_LANES ) ? n - n % VRANLC_LANES : 0;
+
+  if ( m > 0 ) {
+    for ( l = 0; l < VRANLC_LANES; l++ ) {
+      *x = lcg_step( *x, a1, a2 );
+      s[l] = *x;
+    }
+
+    aL = 1.0;
+    randlc_skip( &aL, a, VRANLC_LANES );
+    t1 = r23 * aL;
+    aL1 = (int) t1;
+    aL2 = aL - t23 * aL1;
+
+    for ( i = 0; i < m; i += VRANLC_LANES ) {
+      #pragma omp simd
+      for ( l = 0; l < VRANLC_LANES; l++ ) {
+        y[i + l] = r46 * s[l];
+        s[l] = lcg_step( s[l], aL1, aL2 );
+      }
+    }
+
+    // Y is X scaled by a power of two, so this is exact
+    *x = t46 * y[m - 1];
+  }
+
+  //--------------------------------------------------------------------
+  //  Remaining results one at a time.
+  //--------------------------------------------------------------------
+  for ( i = m; i < n; i++ ) {
+    *x = lcg_step( *x, a1, a2 );
     y[i] = r46 * (*x);
   }
 
@@ -2,6 +2,7 @@
 #define __RANDDP_H__
 
 double randlc( double *x, double a );
+double randlc_skip( double *x, double a, long n );
 void vranlc( int n, double *x, double a, double y[] );
 
 #endif
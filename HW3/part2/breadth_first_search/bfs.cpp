@@ -3,16 +3,36 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include <cstddef>
 #include <omp.h>
 #include<cmath>
+#include <algorithm>
+#include <utility>
+#include <vector>
 using namespace std;
 #include "../common/CycleTimer.h"
 #include "../common/graph.h"
+#include "../common/bitmap.h"
 
 #define ROOT_NODE_ID 0
 #define NOT_VISITED_MARKER -1
 
+// Frontier chunk size of top-down steps
+#define TOP_DOWN_CHUNK 256
+
+// distances[v] while a top-down step has v claimed from frontier
+// position i: below NOT_VISITED_MARKER, and lower for earlier positions
+#define CLAIMED_BY(i) (INT_MIN + (i))
+
+// Direction switch thresholds of bfs_hybrid; see there.
+#ifndef BFS_ALPHA
+#define BFS_ALPHA 15
+#endif
+#ifndef BFS_BETA
+#define BFS_BETA 18
+#endif
+
 void vertex_set_clear(vertex_set *list)
 {
     list->count = 0;
@@ -25,196 +45,641 @@ void vertex_set_init(vertex_set *list, int count)
     vertex_set_clear(list);
 }
 
+void bfs_context_init(bfs_context *ctx, Graph graph, int *distances)
+{
+    int n = num_nodes(graph);
+
+    ctx->graph = graph;
+    ctx->owns_distances = (distances == NULL);
+    ctx->distances = ctx->owns_distances ? (int *)malloc(sizeof(int) * n) : distances;
+    ctx->queue = (int *)malloc(sizeof(int) * (n > 0 ? n : 1));
+    ctx->num_reached = 0;
+
+    // written by the same static schedule the steps read them with, so
+    // the pages land on the nodes of the threads that use them
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < n; i++) {
+        ctx->distances[i] = NOT_VISITED_MARKER;
+        ctx->queue[i] = 0;
+    }
+
+    bitmap_init(&ctx->visited, n);
+    bitmap_init(&ctx->frontier_bits, n);
+    bitmap_init(&ctx->next_bits, n);
+
+    ctx->chunk_offsets = (int *)malloc(sizeof(int) * (n / TOP_DOWN_CHUNK + 2));
+    ctx->thread_buffers = new std::vector<top_down_buffer>(omp_get_max_threads());
+}
+
+void bfs_context_destroy(bfs_context *ctx)
+{
+    if (ctx->owns_distances)
+        free(ctx->distances);
+    free(ctx->queue);
+    bitmap_free(&ctx->visited);
+    bitmap_free(&ctx->frontier_bits);
+    bitmap_free(&ctx->next_bits);
+    free(ctx->chunk_offsets);
+    delete ctx->thread_buffers;
+}
+
+bfs_context *bfs_context_create(Graph graph)
+{
+    bfs_context *ctx = (bfs_context *)malloc(sizeof(bfs_context));
+    bfs_context_init(ctx, graph, NULL);
+    return ctx;
+}
+
+void bfs_context_free(bfs_context *ctx)
+{
+    bfs_context_destroy(ctx);
+    free(ctx);
+}
+
+// Undoes the previous run, touching only the vertices it reached, and
+// puts root on the first frontier.  The bitmaps need no reset: the
+// steps rebuild them before reading.
+static void bfs_context_start(bfs_context *ctx, int root)
+{
+    if (root < 0 || root >= num_nodes(ctx->graph)) {
+        fprintf(stderr, "BFS root %d is not a vertex\n", root);
+        exit(1);
+    }
+
+    int *queue = ctx->queue;
+    int *distances = ctx->distances;
+
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < ctx->num_reached; i++)
+        distances[queue[i]] = NOT_VISITED_MARKER;
+
+    distances[root] = 0;
+    queue[0] = root;
+    ctx->num_reached = 1;
+}
+
+// The part of the queue between begin and end as a vertex_set, with room
+// to grow up to the end of the queue.
+static vertex_set queue_slice(bfs_context *ctx, int begin, int end)
+{
+    vertex_set set;
+    set.count = end - begin;
+    set.max_vertices = num_nodes(ctx->graph) - begin;
+    set.vertices = ctx->queue + begin;
+    return set;
+}
+
+
 // Take one step of "top-down" BFS.  For each vertex on the frontier,
 // follow all outgoing edges, and add all neighboring vertices to the
 // new_frontier.
-void top_down_step(
-    Graph g,
+//
+// The frontier is processed in fixed chunks of TOP_DOWN_CHUNK vertices.
+// A vertex with several parents on the frontier goes to the first of
+// them: while the step runs, distances[v] holds CLAIMED_BY(i) for the
+// lowest frontier position i that reached v so far, lowered with
+// compare-and-swap.  Each thread keeps the (vertex, position) pairs its
+// chunks claimed in its buffer in ctx.  Once all chunks ran, the pairs
+// still holding their claim are kept, a scan over the per-chunk counts
+// gives every chunk its place in new_frontier, and the threads copy
+// their vertices out and set their distances.  No shared counter is
+// touched per vertex, and new_frontier comes out in the order a serial
+// top-down step produces, whatever the schedule.
+//
+// Returns the number of edges leaving the new frontier.
+EdgeIndex top_down_step(
+    bfs_context *ctx,
     vertex_set *frontier,
-    vertex_set *new_frontier,
-    int *distances)
+    vertex_set *new_frontier)
 {
-    #pragma omp parallel for 
-    for (int i = 0; i < frontier->count; i++)
+    Graph g = ctx->graph;
+    int *distances = ctx->distances;
+    int *chunk_offsets = ctx->chunk_offsets;
+
+    new_frontier->count = 0;
+    if (frontier->count == 0)
+        return 0;
+
+    EdgeIndex frontier_edges = 0;
+    int new_distance = distances[frontier->vertices[0]] + 1;
+    int num_chunks = (frontier->count + TOP_DOWN_CHUNK - 1) / TOP_DOWN_CHUNK;
+
+    // the thread count may have grown since the context was made
+    int max_threads = omp_get_max_threads();
+    if ((int)ctx->thread_buffers->size() < max_threads)
+        ctx->thread_buffers->resize(max_threads);
+    std::vector<top_down_buffer> &buffers = *ctx->thread_buffers;
+
+    #pragma omp parallel num_threads(max_threads) reduction(+:frontier_edges)
     {
+        top_down_buffer &buf = buffers[omp_get_thread_num()];
+        buf.vertices.clear();
+        buf.parents.clear();
+        buf.chunks.clear();
+        buf.chunk_starts.clear();
+
+        #pragma omp for schedule(dynamic, 1)
+        for (int c = 0; c < num_chunks; c++)
+        {
+            int begin = c * TOP_DOWN_CHUNK;
+            int end = std::min(begin + TOP_DOWN_CHUNK, frontier->count);
 
-        int node = frontier->vertices[i];
+            buf.chunks.push_back(c);
+            buf.chunk_starts.push_back((int)buf.vertices.size());
+
+            for (int i = begin; i < end; i++)
+            {
+                int node = frontier->vertices[i];
+                int claim = CLAIMED_BY(i);
+
+                EdgeIndex start_edge = g->outgoing_starts[node];
+                EdgeIndex end_edge = (node == g->num_nodes - 1)
+                                         ? g->num_edges
+                                         : g->outgoing_starts[node + 1];
+
+                // claim every neighbor that is unvisited or claimed
+                // from a later frontier position
+                for (EdgeIndex neighbor = start_edge; neighbor < end_edge; neighbor++)
+                {
+                    int outgoing = g->outgoing_edges[neighbor];
+                    int old = distances[outgoing];
+
+                    while (old < 0 && old > claim)
+                    {
+                        if (__sync_bool_compare_and_swap(&distances[outgoing], old, claim))
+                        {
+                            buf.vertices.push_back(outgoing);
+                            buf.parents.push_back(i);
+                            break;
+                        }
+                        old = distances[outgoing];
+                    }
+                }
+            }
+        }
+        buf.chunk_starts.push_back((int)buf.vertices.size());
 
-        int start_edge = g->outgoing_starts[node];
-        int end_edge = (node == g->num_nodes - 1)
-                           ? g->num_edges
-                           : g->outgoing_starts[node + 1];
+        // keep the pairs whose claim survived, in place
+        int kept = 0;
+        for (size_t k = 0; k < buf.chunks.size(); k++)
+        {
+            int from = buf.chunk_starts[k];
+            int to = buf.chunk_starts[k + 1];
+            buf.chunk_starts[k] = kept;
+            for (int e = from; e < to; e++)
+            {
+                int v = buf.vertices[e];
+                if (distances[v] == CLAIMED_BY(buf.parents[e]))
+                    buf.vertices[kept++] = v;
+            }
+            chunk_offsets[buf.chunks[k] + 1] = kept - buf.chunk_starts[k];
+        }
+        buf.chunk_starts[buf.chunks.size()] = kept;
 
-        // attempt to add all neighbors to the new frontier
-        #pragma omp simd
-        for (int neighbor = start_edge; neighbor < end_edge; neighbor++)
+        #pragma omp barrier
+        #pragma omp single
         {
-            int outgoing = g->outgoing_edges[neighbor];
+            chunk_offsets[0] = 0;
+            for (int c = 0; c < num_chunks; c++)
+                chunk_offsets[c + 1] += chunk_offsets[c];
+            new_frontier->count = chunk_offsets[num_chunks];
+        }
 
-            if (__sync_bool_compare_and_swap(&distances[outgoing], NOT_VISITED_MARKER, distances[node] + 1))
+        for (size_t k = 0; k < buf.chunks.size(); k++)
+        {
+            int *out = new_frontier->vertices + chunk_offsets[buf.chunks[k]];
+            for (int e = buf.chunk_starts[k]; e < buf.chunk_starts[k + 1]; e++)
             {
-                int index = __sync_fetch_and_add(&new_frontier->count, 1);
-                new_frontier->vertices[index] = outgoing;
+                int v = buf.vertices[e];
+                *out++ = v;
+                distances[v] = new_distance;
+                frontier_edges += outgoing_size(g, v);
             }
         }
     }
 
+    return frontier_edges;
 }
 
 // Implements top-down BFS.
 //
 // Result of execution is that, for each node in the graph, the
-// distance to the root is stored in sol.distances.
-void bfs_top_down(Graph graph, solution *sol)
+// distance to root is stored in ctx->distances.  Each level is appended
+// to ctx->queue right after the one it was discovered from.
+void bfs_top_down(bfs_context *ctx, int root)
 {
+    bfs_context_start(ctx, root);
 
-    vertex_set list1;
-    vertex_set list2;
-    vertex_set_init(&list1, graph->num_nodes);
-    vertex_set_init(&list2, graph->num_nodes);
-
-    vertex_set *frontier = &list1;
-    vertex_set *new_frontier = &list2;
-
-    #pragma omp parallel for
-    for (int i = 0; i < graph->num_nodes; i++)
-        sol->distances[i] = NOT_VISITED_MARKER;
-
-    frontier->vertices[frontier->count++] = ROOT_NODE_ID;
-    sol->distances[ROOT_NODE_ID] = 0;
-
-    while (frontier->count != 0)
+    int head = 0;
+    while (head < ctx->num_reached)
     {
 
 #ifdef VERBOSE
         double start_time = CycleTimer::currentSeconds();
 #endif
 
+        vertex_set frontier = queue_slice(ctx, head, ctx->num_reached);
+        vertex_set new_frontier = queue_slice(ctx, ctx->num_reached, ctx->num_reached);
 
-            vertex_set_clear(new_frontier);
+        top_down_step(ctx, &frontier, &new_frontier);
 
-            top_down_step(graph, frontier, new_frontier, sol->distances);
-        
 #ifdef VERBOSE
         double end_time = CycleTimer::currentSeconds();
-        printf("frontier=%-10d %.4f sec\n", frontier->count, end_time - start_time);
+        printf("frontier=%-10d %.4f sec\n", frontier.count, end_time - start_time);
 #endif
 
-        // swap pointers
+        head = ctx->num_reached;
+        ctx->num_reached += new_frontier.count;
+    }
+}
+
+void bfs_top_down(Graph graph, solution *sol)
+{
+    bfs_context ctx;
+    bfs_context_init(&ctx, graph, sol->distances);
+    bfs_top_down(&ctx, ROOT_NODE_ID);
+    bfs_context_destroy(&ctx);
+}
 
-            vertex_set *tmp = frontier;
-            frontier = new_frontier;
-            new_frontier = tmp;
-        
+// Builds the dense BFS state from the queue: visited gets every vertex
+// reached so far and frontier the ones from head on.  Used when
+// bfs_hybrid switches from top-down to bottom-up steps.
+static void bitmaps_from_queue(bfs_context *ctx, int head)
+{
+    bitmap_clear(&ctx->visited);
+    bitmap_clear(&ctx->frontier_bits);
+
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < ctx->num_reached; i++) {
+        bitmap_set_atomic(&ctx->visited, ctx->queue[i]);
+        if (i >= head)
+            bitmap_set_atomic(&ctx->frontier_bits, ctx->queue[i]);
     }
-    
 }
 
-vertex_set* bottom_up_step(Graph g, int *distances, int curDis, vertex_set *new_frontier) {
-    #pragma omp parallel 
+// Overwrites list with the vertices of b in increasing order.  Each
+// thread popcounts a contiguous range of words, a scan of the counts
+// gives its output offset, and the threads then write without atomics.
+static void bitmap_to_vertex_set(const bitmap *b, vertex_set *list)
+{
+    int max_threads = omp_get_max_threads();
+    int *offsets = (int *)malloc(sizeof(int) * (max_threads + 1));
+    int total = 0;
+
+    #pragma omp parallel num_threads(max_threads)
     {
-        #pragma omp for nowait
-        for (int i = 0; i < g->num_nodes; i++) {
-            if (distances[i] != NOT_VISITED_MARKER) 
-                continue;
-            
-            const Vertex* start = incoming_begin(g, i);
-            const Vertex* end = incoming_end(g, i);
-            bool found = 0;
-            for (const Vertex* neighbor = start; neighbor != end; neighbor++) {
-                if (distances[*neighbor] == curDis) {
-                    if (new_frontier) {
-                        int index = __sync_fetch_and_add(&new_frontier->count, 1);
-                        new_frontier->vertices[index] = i;
-                    }
+        int t = omp_get_thread_num();
+        int nt = omp_get_num_threads();
+        int begin = (int)((int64_t)b->num_words * t / nt);
+        int end = (int)((int64_t)b->num_words * (t + 1) / nt);
+
+        int count = 0;
+        for (int w = begin; w < end; w++)
+            count += __builtin_popcountll(b->words[w]);
+        offsets[t + 1] = count;
+
+        #pragma omp barrier
+        #pragma omp single
+        {
+            offsets[0] = 0;
+            for (int i = 0; i < nt; i++)
+                offsets[i + 1] += offsets[i];
+            total = offsets[nt];
+        }
+
+        int index = offsets[t];
+        for (int w = begin; w < end; w++) {
+            uint64_t word = b->words[w];
+            while (word) {
+                list->vertices[index++] = w * BITMAP_WORD_BITS + __builtin_ctzll(word);
+                word &= word - 1;
+            }
+        }
+    }
+
+    list->count = total;
+    free(offsets);
+}
+
+// Take one step of "bottom-up" BFS.  Every unvisited vertex looks for an
+// in-neighbor on the frontier; the ones that find one get distance
+// curDis + 1 and make up the next frontier.
+//
+// The frontier, the next frontier and the visited set are bitmaps.
+// Threads own whole words of visited/next, so a word of 64 visited
+// vertices is skipped with one test, frontier probes read one bit per
+// in-neighbor, and newly found vertices are recorded without atomics.
+// Returns the size of the next frontier and, in *frontier_edges, the
+// number of edges leaving it.
+//
+// G is Graph or CompressedGraph: only the incoming_begin/incoming_end
+// iterators differ.
+template <typename G>
+int bottom_up_step(G g, const bitmap *frontier, bitmap *next, bitmap *visited, int *distances, int curDis,
+                   EdgeIndex *frontier_edges)
+{
+    int count = 0;
+    EdgeIndex edges = 0;
+
+    #pragma omp parallel for schedule(dynamic, 64) reduction(+:count, edges)
+    for (int w = 0; w < visited->num_words; w++) {
+        uint64_t unvisited = ~visited->words[w] & bitmap_valid_mask(visited, w);
+        uint64_t found = 0;
+
+        while (unvisited) {
+            int bit = __builtin_ctzll(unvisited);
+            unvisited &= unvisited - 1;
+
+            int i = w * BITMAP_WORD_BITS + bit;
+            auto end = incoming_end(g, i);
+            for (auto neighbor = incoming_begin(g, i); neighbor != end; neighbor++) {
+                if (bitmap_test(frontier, *neighbor)) {
+                    found |= (uint64_t)1 << bit;
                     distances[i] = curDis + 1;
+                    edges += outgoing_size(g, i);
                     break;
                 }
             }
         }
+
+        next->words[w] = found;
+        visited->words[w] |= found;
+        count += __builtin_popcountll(found);
     }
-    return new_frontier;
+
+    *frontier_edges = edges;
+    return count;
 }
 
-void bfs_bottom_up(Graph graph, solution *sol) {
-    
+template <typename G>
+static void bfs_bottom_up_impl(G graph, solution *sol) {
+
+    int numNodes = num_nodes(graph);
+
     #pragma omp parallel for simd
-    for (int i = 0; i < graph->num_nodes; i++) {
+    for (int i = 0; i < numNodes; i++) {
         sol->distances[i] = -1;
     }
 
+    bitmap visited, frontier, next;
+    bitmap_init(&visited, numNodes);
+    bitmap_init(&frontier, numNodes);
+    bitmap_init(&next, numNodes);
+
     sol->distances[ROOT_NODE_ID] = 0;
+    bitmap_set(&visited, ROOT_NODE_ID);
+    bitmap_set(&frontier, ROOT_NODE_ID);
+
     int curDis = 0;
-    int remainCount = graph->num_nodes - 1;
+    EdgeIndex frontier_edges;
+    while (bottom_up_step(graph, &frontier, &next, &visited, sol->distances, curDis, &frontier_edges) != 0) {
+        std::swap(frontier, next);
+        curDis++;
+    }
 
-    while (1) {
-        int preCount = remainCount;
+    bitmap_free(&visited);
+    bitmap_free(&frontier);
+    bitmap_free(&next);
+}
 
-        bottom_up_step(graph, sol->distances, curDis, nullptr);
+void bfs_bottom_up(Graph graph, solution *sol) {
+    bfs_bottom_up_impl(graph, sol);
+}
 
-        remainCount = 0;
-        #pragma omp parallel for reduction(+:remainCount)
-        for (int i = 0; i < graph->num_nodes; i++) {
-            if (sol->distances[i] == -1) remainCount++;
+void bfs_bottom_up(CompressedGraph graph, solution *sol) {
+    bfs_bottom_up_impl(graph, sol);
+}
+
+// Direction-optimizing BFS (Beamer, Asanovic and Patterson).  Top-down
+// steps cost about the edges leaving the frontier (m_f); bottom-up steps
+// cost about the edges into still unvisited vertices (m_u), and much less
+// once the frontier is large enough that most of them find a parent
+// early.  Go bottom-up once m_f > m_u / BFS_ALPHA while the frontier is
+// growing, and back top-down once it is shrinking and holds fewer than
+// n / BFS_BETA vertices.  Both counts come out of the steps themselves.
+void bfs_hybrid(bfs_context *ctx, int root)
+{
+    Graph graph = ctx->graph;
+    int numNodes = num_nodes(graph);
+
+    bfs_context_start(ctx, root);
+
+    // set while the frontier is held in ctx->frontier_bits
+    bool dense = false;
+
+    int head = 0;
+    int curDis = 0;
+    int prevCount = 0;
+    EdgeIndex frontierEdges = outgoing_size(graph, root);
+    EdgeIndex unexploredEdges = num_edges(graph) - frontierEdges;
+
+    while (head < ctx->num_reached) {
+        int frontierCount = ctx->num_reached - head;
+        bool growing = frontierCount > prevCount;
+        bool useBottomUp = dense
+            ? growing || frontierCount >= numNodes / BFS_BETA
+            : growing && frontierEdges > unexploredEdges / BFS_ALPHA;
+        prevCount = frontierCount;
+
+        vertex_set new_frontier = queue_slice(ctx, ctx->num_reached, ctx->num_reached);
+
+        if (useBottomUp) {
+            if (!dense) {
+                bitmaps_from_queue(ctx, head);
+                dense = true;
+            }
+            bottom_up_step(graph, &ctx->frontier_bits, &ctx->next_bits, &ctx->visited, ctx->distances, curDis,
+                           &frontierEdges);
+            // keep the queue complete so the next reset stays cheap
+            // and a switch back to top-down needs no conversion
+            bitmap_to_vertex_set(&ctx->next_bits, &new_frontier);
+            std::swap(ctx->frontier_bits, ctx->next_bits);
+        } else {
+            dense = false;
+            vertex_set frontier = queue_slice(ctx, head, ctx->num_reached);
+            frontierEdges = top_down_step(ctx, &frontier, &new_frontier);
         }
 
-        if (preCount == remainCount) 
-            break;
-        
-        curDis++;
+        head = ctx->num_reached;
+        ctx->num_reached += new_frontier.count;
+        unexploredEdges -= frontierEdges;
+        curDis ++;
     }
 }
 
 void bfs_hybrid(Graph graph, solution *sol)
 {
-    int numNodes = graph -> num_nodes;
-    int threshold  = static_cast <int> (round(sqrt( static_cast <float>(numNodes))));
-    threshold  = 100000;
+    bfs_context ctx;
+    bfs_context_init(&ctx, graph, sol->distances);
+    bfs_hybrid(&ctx, ROOT_NODE_ID);
+    bfs_context_destroy(&ctx);
+}
 
-    vertex_set list1;
-    vertex_set list2;
-    vertex_set_init(&list1, graph->num_nodes);
-    vertex_set_init(&list2, graph->num_nodes);
+// Appends the vertices of local to list at a position reserved with one
+// atomic add on *count; the order of the threads' pieces is arbitrary.
+static void append_vertices(const std::vector<int> &local, int *list, int *count)
+{
+    int at = __sync_fetch_and_add(count, (int)local.size());
+    for (size_t i = 0; i < local.size(); i++)
+        list[at + i] = local[i];
+}
 
-    vertex_set *frontier = &list1;
-    vertex_set *new_frontier = &list2;
+// Multi-source BFS (Then et al., "The More the Merrier").  Source s owns
+// bit s of the per-vertex masks: seen[v] has the sources that reached v,
+// visit[v] the sources for which v is on the current frontier.  One
+// scan of an edge u -> v advances every source in visit[u] at once.
+//
+// Levels whose frontier has many out-edges are done bottom-up: each
+// vertex ORs visit over its in-neighbors, and only its own masks are
+// written.  Sparse levels push visit along out-edges with an atomic OR
+// into next instead.  They work from a list of the frontier vertices
+// and a list of the vertices they touched, so their cost follows the
+// frontier and not the graph: next is all zeros between levels, and
+// only the touched entries are kept or cleared, and only the frontier
+// entries of visit are cleared.
+void bfs_multi_source(Graph graph, const int *sources, int num_sources, int *distances)
+{
+    if (num_sources < 1 || num_sources > MS_BFS_MAX_SOURCES) {
+        fprintf(stderr, "bfs_multi_source: %d sources, expected 1 to %d\n",
+                num_sources, MS_BFS_MAX_SOURCES);
+        exit(1);
+    }
 
-    #pragma omp parallel for
-    for (int i = 0; i < graph->num_nodes; i++)
-        sol->distances[i] = NOT_VISITED_MARKER;
+    int numNodes = num_nodes(graph);
+    uint64_t all = (num_sources == 64) ? ~(uint64_t)0 : (((uint64_t)1 << num_sources) - 1);
 
-    frontier->vertices[frontier->count++] = ROOT_NODE_ID;
-    sol->distances[ROOT_NODE_ID] = 0;
+    uint64_t *seen = (uint64_t *)malloc(sizeof(uint64_t) * numNodes);
+    uint64_t *visit = (uint64_t *)malloc(sizeof(uint64_t) * numNodes);
+    uint64_t *next = (uint64_t *)malloc(sizeof(uint64_t) * numNodes);
+    int *frontier = (int *)malloc(sizeof(int) * numNodes);
+    int *touched = (int *)malloc(sizeof(int) * numNodes);
+
+    #pragma omp parallel for schedule(static)
+    for (int v = 0; v < numNodes; v++) {
+        seen[v] = 0;
+        visit[v] = 0;
+        next[v] = 0;
+    }
+
+    #pragma omp parallel for schedule(static)
+    for (int64_t i = 0; i < (int64_t)num_sources * numNodes; i++)
+        distances[i] = NOT_VISITED_MARKER;
+
+    EdgeIndex frontierEdges = 0;
+    int frontierCount = 0;
+    for (int s = 0; s < num_sources; s++) {
+        int v = sources[s];
+        if (v < 0 || v >= numNodes) {
+            fprintf(stderr, "bfs_multi_source: source %d is not a vertex\n", v);
+            exit(1);
+        }
+        if (visit[v] == 0) {
+            frontierEdges += outgoing_size(graph, v);
+            frontier[frontierCount++] = v;
+        }
+        seen[v] |= (uint64_t)1 << s;
+        visit[v] |= (uint64_t)1 << s;
+        distances[(int64_t)s * numNodes + v] = 0;
+    }
 
     int curDis = 0;
-    int remainCount = graph->num_nodes - 1;
 
-    while (frontier->count != 0) {
-        bool useBottomUp = frontier->count > threshold;
-        vertex_set_clear(new_frontier);
+    while (frontierCount > 0) {
+        int newDis = curDis + 1;
+        EdgeIndex edges = 0;
+        int nextCount = 0;
 
-        if (useBottomUp) {
-            int preCount = 0;
-            int remainCount = 0;
+        if (frontierEdges > num_edges(graph) / BFS_ALPHA) {
+            #pragma omp parallel reduction(+:edges)
+            {
+                std::vector<int> local;
+
+                #pragma omp for schedule(dynamic, 1024) nowait
+                for (int v = 0; v < numNodes; v++) {
+                    uint64_t found = 0;
+                    if (seen[v] != all) {
+                        const Vertex *end = incoming_end(graph, v);
+                        for (const Vertex *u = incoming_begin(graph, v); u != end; u++)
+                            found |= visit[*u];
+                        found &= ~seen[v];
+                    }
+                    next[v] = found;
+                    if (found) {
+                        seen[v] |= found;
+                        edges += outgoing_size(graph, v);
+                        local.push_back(v);
+                        for (uint64_t bits = found; bits; bits &= bits - 1)
+                            distances[(int64_t)__builtin_ctzll(bits) * numNodes + v] = newDis;
+                    }
+                }
 
-            #pragma omp parallel for reduction(+:preCount)
-            for (int i = 0; i < graph->num_nodes; i++) 
-                if (sol->distances[i] == -1) preCount++;
-            
-            bottom_up_step(graph, sol -> distances, curDis, new_frontier);
+                append_vertices(local, touched, &nextCount);
+            }
 
-            #pragma omp parallel for reduction(+:remainCount)
-            for (int i = 0; i < graph->num_nodes; i++) 
-                if (sol->distances[i] == -1) remainCount++;
+            #pragma omp parallel for schedule(static)
+            for (int v = 0; v < numNodes; v++)
+                visit[v] = 0;
 
-            if (preCount == remainCount) 
-                break;
+            std::swap(frontier, touched);
         } else {
-            top_down_step(graph, frontier, new_frontier, sol -> distances);
+            int touchedCount = 0;
+
+            // the first thread to set bits in next[v] lists v
+            #pragma omp parallel
+            {
+                std::vector<int> local;
+
+                #pragma omp for schedule(dynamic, 64) nowait
+                for (int i = 0; i < frontierCount; i++) {
+                    int u = frontier[i];
+                    uint64_t mask = visit[u];
+                    const Vertex *end = outgoing_end(graph, u);
+                    for (const Vertex *v = outgoing_begin(graph, u); v != end; v++) {
+                        if ((mask & ~seen[*v] & ~next[*v]) != 0 &&
+                            __sync_fetch_and_or(&next[*v], mask) == 0)
+                            local.push_back(*v);
+                    }
+                }
+
+                append_vertices(local, touched, &touchedCount);
+            }
+
+            #pragma omp parallel for schedule(static)
+            for (int i = 0; i < frontierCount; i++)
+                visit[frontier[i]] = 0;
+
+            #pragma omp parallel reduction(+:edges)
+            {
+                std::vector<int> local;
+
+                #pragma omp for schedule(dynamic, 1024) nowait
+                for (int i = 0; i < touchedCount; i++) {
+                    int v = touched[i];
+                    uint64_t found = next[v] & ~seen[v];
+                    next[v] = found;
+                    if (found) {
+                        seen[v] |= found;
+                        edges += outgoing_size(graph, v);
+                        local.push_back(v);
+                        for (uint64_t bits = found; bits; bits &= bits - 1)
+                            distances[(int64_t)__builtin_ctzll(bits) * numNodes + v] = newDis;
+                    }
+                }
+
+                append_vertices(local, frontier, &nextCount);
+            }
         }
-        curDis ++;
-        vertex_set *tmp = frontier;
-        frontier = new_frontier;
-        new_frontier = tmp;
+
+        // visit is all zeros again and becomes next
+        std::swap(visit, next);
+        frontierCount = nextCount;
+        frontierEdges = edges;
+        curDis = newDis;
     }
+
+    free(seen);
+    free(visit);
+    free(next);
+    free(frontier);
+    free(touched);
 }
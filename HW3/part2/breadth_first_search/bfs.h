@@ -4,6 +4,10 @@
 //#define DEBUG
 
 #include "common/graph.h"
+#include "common/compressed_graph.h"
+#include "common/bitmap.h"
+
+#include <vector>
 
 struct solution
 {
@@ -19,9 +23,63 @@ struct vertex_set {
   int *vertices;
 };
 
+// Scratch of one thread in top-down steps: the vertices its chunks
+// claimed, the frontier positions they claimed them from, and where
+// each of its chunks starts in those arrays.
+struct top_down_buffer
+{
+  std::vector<int> vertices;
+  std::vector<int> parents;
+  std::vector<int> chunks;
+  std::vector<int> chunk_starts;
+};
+
+// Buffers for running many BFS over one graph.  They are allocated once,
+// first touched by the threads that later scan them, and after each run
+// only the entries that run wrote are reset.
+struct bfs_context
+{
+  Graph graph;
+  // distances from the root of the last run; -1 where it did not reach
+  int* distances;
+  // the num_reached vertices the last run reached, level after level
+  int* queue;
+  int num_reached;
+  // dense frontier state of bottom-up steps
+  bitmap visited;
+  bitmap frontier_bits;
+  bitmap next_bits;
+  // top-down step scratch: output offsets of the frontier chunks and
+  // one buffer per thread, kept between steps and runs
+  int* chunk_offsets;
+  std::vector<top_down_buffer>* thread_buffers;
+  bool owns_distances;
+};
+
+// Allocates a context for graph.  init fills a caller-provided context
+// and, if distances is not NULL, writes results there instead of into
+// its own array.
+bfs_context* bfs_context_create(Graph graph);
+void bfs_context_free(bfs_context* ctx);
+void bfs_context_init(bfs_context* ctx, Graph graph, int* distances);
+void bfs_context_destroy(bfs_context* ctx);
+
+// BFS from root reusing ctx's buffers; results in ctx->distances
+void bfs_top_down(bfs_context* ctx, int root);
+void bfs_hybrid(bfs_context* ctx, int root);
 
 void bfs_top_down(Graph graph, solution* sol);
 void bfs_bottom_up(Graph graph, solution* sol);
+void bfs_bottom_up(CompressedGraph graph, solution* sol);
 void bfs_hybrid(Graph graph, solution* sol);
 
+// Most sources bfs_multi_source can run at once: one bit of a word each.
+#define MS_BFS_MAX_SOURCES 64
+
+// Runs a BFS from each of the num_sources (1..MS_BFS_MAX_SOURCES)
+// vertices in sources together, sharing every edge scan between them.
+// distances is a num_sources x num_nodes row-major matrix; row s gets the
+// distances from sources[s], -1 for vertices it cannot reach.
+void bfs_multi_source(Graph graph, const int* sources, int num_sources, int* distances);
+
 #endif
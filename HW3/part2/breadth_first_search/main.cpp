@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <omp.h>
+#include <string.h>
 #include <string>
 #include <getopt.h>
 
@@ -14,9 +15,18 @@
 
 #define USE_BINARY_GRAPH 1
 
+#ifdef GRAPH_64BIT_EDGES
+// ref_bfs.a is compiled for 32-bit edge offsets and is not linked into
+// 64-bit builds (see Makefile).  Every search is checked against our
+// own top-down search instead, and the reference timings are its.
+#define reference_bfs_bottom_up bfs_top_down
+#define reference_bfs_top_down bfs_top_down
+#define reference_bfs_hybrid bfs_top_down
+#else
 void reference_bfs_bottom_up(Graph graph, solution* sol);
 void reference_bfs_top_down(Graph graph, solution* sol);
 void reference_bfs_hybrid(Graph graph, solution* sol);
+#endif
 
 int main(int argc, char** argv) {
 
@@ -52,7 +62,7 @@ int main(int argc, char** argv) {
 
     printf("Loading graph...\n");
     if (USE_BINARY_GRAPH) {
-      g = load_graph_binary(graph_filename.c_str());
+      g = load_graph_mmap(graph_filename.c_str());
     } else {
         g = load_graph(argv[1]);
         printf("storing binary form of graph!\n");
@@ -62,7 +72,7 @@ int main(int argc, char** argv) {
     }
     printf("\n");
     printf("Graph stats:\n");
-    printf("  Edges: %d\n", g->num_edges);
+    printf("  Edges: %lld\n", (long long) g->num_edges);
     printf("  Nodes: %d\n", g->num_nodes);
 
     //If we want to run on all threads
@@ -81,6 +91,27 @@ int main(int argc, char** argv) {
         num_threads.push_back(max_threads);
         int n_usage = num_threads.size();
 
+        // the compressed bottom-up search is checked on the same graph
+        CompressedGraph cg = compress_graph(g);
+        printf("  Compressed: %.2f MB\n", compressed_graph_bytes(cg) / (1024.0 * 1024.0));
+
+        // roots of the multi-source search and the repeated searches on
+        // one context, spread over the vertex ids.  Row s is checked
+        // against a top-down search from sources[s] on a fresh context.
+        int num_sources = std::min(MS_BFS_MAX_SOURCES, g->num_nodes);
+        std::vector<int> sources(num_sources);
+        for (int s = 0; s < num_sources; s++)
+            sources[s] = (int)((int64_t) s * g->num_nodes / num_sources);
+
+        int* ms_expected = (int*)malloc(sizeof(int) * (size_t) num_sources * g->num_nodes);
+        int* ms_distances = (int*)malloc(sizeof(int) * (size_t) num_sources * g->num_nodes);
+        for (int s = 0; s < num_sources; s++) {
+            bfs_context* ctx = bfs_context_create(g);
+            bfs_top_down(ctx, sources[s]);
+            memcpy(ms_expected + (size_t) s * g->num_nodes, ctx->distances, sizeof(int) * g->num_nodes);
+            bfs_context_free(ctx);
+        }
+
         solution sol1;
         sol1.distances = (int*)malloc(sizeof(int) * g->num_nodes);
         solution sol2;
@@ -92,8 +123,9 @@ int main(int argc, char** argv) {
         solution sol4;
         sol4.distances = (int*)malloc(sizeof(int) * g->num_nodes);
 
-        double hybrid_base, top_base, bottom_base;
-        double hybrid_time, top_time, bottom_time;
+        double hybrid_base, top_base, bottom_base, compressed_base, ms_base;
+        double hybrid_time, top_time, bottom_time, compressed_time, ms_time;
+        double ctx_top_time, ctx_hybrid_time;
 
         double ref_hybrid_base, ref_top_base, ref_bottom_base;
         double ref_hybrid_time, ref_top_time, ref_bottom_time;
@@ -102,10 +134,17 @@ int main(int argc, char** argv) {
         std::stringstream timing;
         std::stringstream ref_timing;
         std::stringstream relative_timing;
+        std::stringstream compressed_timing;
+        std::stringstream ms_timing;
+        std::stringstream ctx_timing;
 
-        bool tds_check = true, bus_check = true, hs_check = true;
+        bool tds_check = true, bus_check = true, hs_check = true, cbus_check = true;
+        bool ms_check = true, ctx_check = true;
 
         timing          << "Threads  Top Down          Bottom Up         Hybrid\n";
+        compressed_timing << "Threads  Bottom Up\n";
+        ms_timing       << "Threads  " << num_sources << " Roots         Per Root\n";
+        ctx_timing      << "Threads  Top Down    Hybrid      (per root)\n";
         ref_timing      << "Threads  Top Down          Bottom Up         Hybrid\n";
         relative_timing << "Threads       Top Down          Bottom Up             Hybrid\n";
 
@@ -155,6 +194,19 @@ int main(int argc, char** argv) {
                 }
             }
 
+            start = CycleTimer::currentSeconds();
+            bfs_bottom_up(cg, &sol2);
+            compressed_time = CycleTimer::currentSeconds() - start;
+
+            std::cout << "Testing Correctness of Compressed Bottom Up\n";
+            for (int j=0; j<g->num_nodes; j++) {
+                if (sol2.distances[j] != sol4.distances[j]) {
+                    fprintf(stderr, "*** Results disagree at %d: %d, %d\n", j, sol2.distances[j], sol4.distances[j]);
+                    cbus_check = false;
+                    break;
+                }
+            }
+
             start = CycleTimer::currentSeconds();
             bfs_hybrid(g, &sol3);
             hybrid_time = CycleTimer::currentSeconds() - start;
@@ -173,12 +225,68 @@ int main(int argc, char** argv) {
                 }
             }
 
+            start = CycleTimer::currentSeconds();
+            bfs_multi_source(g, sources.data(), num_sources, ms_distances);
+            ms_time = CycleTimer::currentSeconds() - start;
+
+            std::cout << "Testing Correctness of Multi-Source\n";
+            bool ms_agree = true;
+            for (int s=0; s<num_sources && ms_agree; s++) {
+                const int* row = ms_distances + (size_t) s * g->num_nodes;
+                const int* expected = ms_expected + (size_t) s * g->num_nodes;
+                for (int j=0; j<g->num_nodes; j++) {
+                    if (row[j] != expected[j]) {
+                        fprintf(stderr, "*** Results disagree at %d from root %d: %d, %d\n",
+                                j, sources[s], row[j], expected[j]);
+                        ms_agree = false;
+                        break;
+                    }
+                }
+            }
+            ms_check = ms_check && ms_agree;
+
+            // one context for all roots, alternating top-down and hybrid
+            // searches: each run must start from the state the previous
+            // one left after its reset
+            bfs_context* ctx = bfs_context_create(g);
+            ctx_top_time = 0;
+            ctx_hybrid_time = 0;
+            std::cout << "Testing Correctness of Repeated Roots\n";
+            bool ctx_agree = true;
+            for (int s=0; s<num_sources && ctx_agree; s++) {
+                const int* expected = ms_expected + (size_t) s * g->num_nodes;
+                for (int run=0; run<2 && ctx_agree; run++) {
+                    start = CycleTimer::currentSeconds();
+                    if (run == 0) {
+                        bfs_top_down(ctx, sources[s]);
+                        ctx_top_time += CycleTimer::currentSeconds() - start;
+                    } else {
+                        bfs_hybrid(ctx, sources[s]);
+                        ctx_hybrid_time += CycleTimer::currentSeconds() - start;
+                    }
+
+                    for (int j=0; j<g->num_nodes; j++) {
+                        if (ctx->distances[j] != expected[j]) {
+                            fprintf(stderr, "*** Results disagree at %d from root %d (%s): %d, %d\n",
+                                    j, sources[s], run == 0 ? "top down" : "hybrid",
+                                    ctx->distances[j], expected[j]);
+                            ctx_agree = false;
+                            break;
+                        }
+                    }
+                }
+            }
+            bfs_context_free(ctx);
+            ctx_check = ctx_check && ctx_agree;
+
             if (i == 0)
             {
                 hybrid_base = hybrid_time;
                 ref_hybrid_base = ref_hybrid_time;
                 top_base = top_time;
                 bottom_base = bottom_time;
+                compressed_base = compressed_time;
+                ms_base = ms_time;
                 ref_top_base = ref_top_time;
                 ref_bottom_base = ref_bottom_time;
 
@@ -187,6 +295,9 @@ int main(int argc, char** argv) {
             char buf[1024];
             char ref_buf[1024];
             char relative_buf[1024];
+            char compressed_buf[1024];
+            char ms_buf[1024];
+            char ctx_buf[1024];
 
             sprintf(buf, "%4d:    %.2f (%.2fx)      %.2f (%.2fx)      %.2f (%.2fx)\n",
                     num_threads[i], top_time, top_base/top_time, bottom_time,
@@ -196,10 +307,19 @@ int main(int argc, char** argv) {
                     ref_bottom_base/ref_bottom_time, ref_hybrid_time, ref_hybrid_base/ref_hybrid_time);
             sprintf(relative_buf, "%4d:   %14.2f     %14.2f     %14.2f\n",
                     num_threads[i], ref_top_time/top_time, ref_bottom_time/bottom_time, ref_hybrid_time/hybrid_time);
+            sprintf(compressed_buf, "%4d:    %.2f (%.2fx)\n",
+                    num_threads[i], compressed_time, compressed_base/compressed_time);
+            sprintf(ms_buf, "%4d:    %.2f (%.2fx)      %.4f\n",
+                    num_threads[i], ms_time, ms_base/ms_time, ms_time/num_sources);
+            sprintf(ctx_buf, "%4d:    %.4f      %.4f\n",
+                    num_threads[i], ctx_top_time/num_sources, ctx_hybrid_time/num_sources);
 
             timing << buf;
             ref_timing << ref_buf;
             relative_timing << relative_buf;
+            compressed_timing << compressed_buf;
+            ms_timing << ms_buf;
+            ctx_timing << ctx_buf;
         }
 
         printf("----------------------------------------------------------\n");
@@ -209,6 +329,15 @@ int main(int argc, char** argv) {
         std::cout << "Reference: Timing Summary" << std::endl;
         std::cout << ref_timing.str();
         printf("----------------------------------------------------------\n");
+        std::cout << "Compressed Graph: Timing Summary" << std::endl;
+        std::cout << compressed_timing.str();
+        printf("----------------------------------------------------------\n");
+        std::cout << "Multi-Source: Timing Summary" << std::endl;
+        std::cout << ms_timing.str();
+        printf("----------------------------------------------------------\n");
+        std::cout << "Repeated Roots on One Context: Timing Summary" << std::endl;
+        std::cout << ctx_timing.str();
+        printf("----------------------------------------------------------\n");
         std::cout << "Correctness: " << std::endl;
         if (!tds_check)
             std::cout << "Top Down Search is not Correct" << std::endl;
@@ -216,7 +345,17 @@ int main(int argc, char** argv) {
             std::cout << "Bottom Up Search is not Correct" << std::endl;
         if (!hs_check)
             std::cout << "Hybrid Search is not Correct" << std::endl;
+        if (!cbus_check)
+            std::cout << "Compressed Bottom Up Search is not Correct" << std::endl;
+        if (!ms_check)
+            std::cout << "Multi-Source Search is not Correct" << std::endl;
+        if (!ctx_check)
+            std::cout << "Repeated Root Search is not Correct" << std::endl;
         std::cout << std::endl << "Speedup vs. Reference: " << std::endl <<  relative_timing.str();
+
+        free(ms_expected);
+        free(ms_distances);
+        free_compressed_graph(cg);
     }
     //Run the code with only one thread count and only report speedup
     else
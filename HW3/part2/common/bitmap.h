@@ -0,0 +1,76 @@
+#ifndef __BITMAP_H__
+#define __BITMAP_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+
+// Dense set of vertex ids, one bit per vertex and 64 vertices per word.
+// Word-level loops (test a whole word of visited flags at once, popcount
+// a word of newly found vertices) are what make these cheaper than an
+// int per vertex.
+struct bitmap
+{
+  int num_bits;
+  int num_words;
+  uint64_t* words;
+};
+
+#define BITMAP_WORD_BITS 64
+
+static inline int bitmap_words(int num_bits)
+{
+  return (num_bits + BITMAP_WORD_BITS - 1) / BITMAP_WORD_BITS;
+}
+
+// Allocates a cleared bitmap.  The words are zeroed by a parallel loop
+// so their pages are first touched by the threads that scan them.
+static inline void bitmap_init(bitmap* b, int num_bits)
+{
+  b->num_bits = num_bits;
+  b->num_words = bitmap_words(num_bits);
+  b->words = (uint64_t*)malloc(sizeof(uint64_t) * (b->num_words > 0 ? b->num_words : 1));
+
+  #pragma omp parallel for schedule(static)
+  for (int w = 0; w < b->num_words; w++)
+    b->words[w] = 0;
+}
+
+static inline void bitmap_free(bitmap* b)
+{
+  free(b->words);
+  b->words = NULL;
+}
+
+static inline void bitmap_clear(bitmap* b)
+{
+  #pragma omp parallel for schedule(static)
+  for (int w = 0; w < b->num_words; w++)
+    b->words[w] = 0;
+}
+
+static inline bool bitmap_test(const bitmap* b, int i)
+{
+  return (b->words[i / BITMAP_WORD_BITS] >> (i % BITMAP_WORD_BITS)) & 1;
+}
+
+// Not safe against concurrent writers of the same word; see
+// bitmap_set_atomic.
+static inline void bitmap_set(bitmap* b, int i)
+{
+  b->words[i / BITMAP_WORD_BITS] |= (uint64_t) 1 << (i % BITMAP_WORD_BITS);
+}
+
+static inline void bitmap_set_atomic(bitmap* b, int i)
+{
+  __sync_fetch_and_or(&b->words[i / BITMAP_WORD_BITS], (uint64_t) 1 << (i % BITMAP_WORD_BITS));
+}
+
+// Mask of the bits of word w that correspond to real vertices (all of
+// them except in the last, partially used word).
+static inline uint64_t bitmap_valid_mask(const bitmap* b, int w)
+{
+  int tail = b->num_bits - w * BITMAP_WORD_BITS;
+  return (tail >= BITMAP_WORD_BITS) ? ~(uint64_t) 0 : (((uint64_t) 1 << tail) - 1);
+}
+
+#endif
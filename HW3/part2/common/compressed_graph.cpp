@@ -0,0 +1,261 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <vector>
+#include <omp.h>
+
+#include "compressed_graph.h"
+
+#define COMPRESSED_GRAPH_HEADER_TOKEN ((int) 0xDEADBEE3)
+#define COMPRESSED_GRAPH_VERSION 1
+
+struct compressed_graph_header
+{
+    int token;
+    int version;
+    int num_nodes;
+    int reserved;
+    int64_t num_edges;
+    int64_t outgoing_bytes;
+    int64_t incoming_bytes;
+};
+
+
+static inline uint32_t zigzag(Vertex v)
+{
+    return ((uint32_t) v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static inline int varint_size(uint32_t v)
+{
+    int size = 1;
+    while (v >= 0x80) {
+        v >>= 7;
+        size++;
+    }
+    return size;
+}
+
+static inline uint8_t* write_varint(uint8_t* out, uint32_t v)
+{
+    while (v >= 0x80) {
+        *out++ = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    *out++ = (uint8_t) v;
+    return out;
+}
+
+// Copies the list [begin, end) into scratch and sorts it, unless it is
+// sorted already.  Returns the list to encode.
+static const Vertex* sorted_list(const Vertex* begin, const Vertex* end, std::vector<Vertex>& scratch)
+{
+    if (std::is_sorted(begin, end))
+        return begin;
+    scratch.assign(begin, end);
+    std::sort(scratch.begin(), scratch.end());
+    return scratch.data();
+}
+
+static int64_t encoded_size(Vertex v, const Vertex* list, int n)
+{
+    if (n == 0)
+        return 0;
+    int64_t size = varint_size(zigzag(list[0] - v));
+    for (int i = 1; i < n; i++)
+        size += varint_size((uint32_t)(list[i] - list[i - 1]));
+    return size;
+}
+
+static void encode(Vertex v, const Vertex* list, int n, uint8_t* out)
+{
+    if (n == 0)
+        return;
+    out = write_varint(out, zigzag(list[0] - v));
+    for (int i = 1; i < n; i++)
+        out = write_varint(out, (uint32_t)(list[i] - list[i - 1]));
+}
+
+// Encodes one side of the CSR (out- or in-lists).  A sizing pass fills
+// offsets with per-vertex byte counts, a scan turns them into offsets,
+// and an encoding pass writes every list in parallel.
+template <typename Begin, typename End>
+static uint8_t* encode_lists(const Graph g, int64_t* offsets, Begin list_begin, End list_end)
+{
+    int n = g->num_nodes;
+
+    #pragma omp parallel
+    {
+        std::vector<Vertex> scratch;
+        #pragma omp for schedule(dynamic, 1024)
+        for (int v = 0; v < n; v++) {
+            const Vertex* begin = list_begin(g, v);
+            const Vertex* end = list_end(g, v);
+            offsets[v + 1] = encoded_size(v, sorted_list(begin, end, scratch), end - begin);
+        }
+    }
+
+    offsets[0] = 0;
+    for (int v = 0; v < n; v++)
+        offsets[v + 1] += offsets[v];
+
+    uint8_t* data = (uint8_t*)malloc(std::max<int64_t>(offsets[n], 1));
+
+    #pragma omp parallel
+    {
+        std::vector<Vertex> scratch;
+        #pragma omp for schedule(dynamic, 1024)
+        for (int v = 0; v < n; v++) {
+            const Vertex* begin = list_begin(g, v);
+            const Vertex* end = list_end(g, v);
+            encode(v, sorted_list(begin, end, scratch), end - begin, data + offsets[v]);
+        }
+    }
+
+    return data;
+}
+
+CompressedGraph compress_graph(const Graph g)
+{
+    compressed_graph* cg = (compressed_graph*)calloc(1, sizeof(compressed_graph));
+    int n = g->num_nodes;
+
+    cg->num_nodes = n;
+    cg->num_edges = g->num_edges;
+    cg->outgoing_offsets = (int64_t*)malloc(sizeof(int64_t) * (n + 1));
+    cg->incoming_offsets = (int64_t*)malloc(sizeof(int64_t) * (n + 1));
+    cg->outgoing_degrees = (int*)malloc(sizeof(int) * n);
+
+    cg->outgoing_data = encode_lists(g, cg->outgoing_offsets,
+        [](const Graph g, Vertex v) { return outgoing_begin(g, v); },
+        [](const Graph g, Vertex v) { return outgoing_end(g, v); });
+    cg->incoming_data = encode_lists(g, cg->incoming_offsets,
+        [](const Graph g, Vertex v) { return incoming_begin(g, v); },
+        [](const Graph g, Vertex v) { return incoming_end(g, v); });
+
+    #pragma omp parallel for
+    for (int v = 0; v < n; v++)
+        cg->outgoing_degrees[v] = outgoing_size(g, v);
+
+    return cg;
+}
+
+size_t compressed_graph_bytes(const CompressedGraph cg)
+{
+    size_t n = cg->num_nodes;
+    return 2 * sizeof(int64_t) * (n + 1) + sizeof(int) * n +
+           cg->outgoing_offsets[n] + cg->incoming_offsets[n];
+}
+
+void free_compressed_graph(CompressedGraph cg)
+{
+    free(cg->outgoing_offsets);
+    free(cg->outgoing_data);
+    free(cg->outgoing_degrees);
+    free(cg->incoming_offsets);
+    free(cg->incoming_data);
+    free(cg);
+}
+
+static void read_array(FILE* input, void* dst, size_t bytes, const char* what)
+{
+    if (fread(dst, 1, bytes, input) != bytes) {
+        fprintf(stderr, "Error reading %s.\n", what);
+        exit(1);
+    }
+}
+
+static void write_array(FILE* output, const void* src, size_t bytes, const char* what)
+{
+    if (fwrite(src, 1, bytes, output) != bytes) {
+        fprintf(stderr, "Error writing %s.\n", what);
+        exit(1);
+    }
+}
+
+CompressedGraph load_compressed_graph(const char* filename)
+{
+    FILE* input = fopen(filename, "rb");
+
+    if (!input) {
+        fprintf(stderr, "Could not open: %s\n", filename);
+        exit(1);
+    }
+
+    compressed_graph_header header;
+    read_array(input, &header, sizeof(header), "header");
+
+    if (header.token != COMPRESSED_GRAPH_HEADER_TOKEN) {
+        fprintf(stderr, "Invalid compressed graph file header. File may be corrupt.\n");
+        exit(1);
+    }
+
+    if (header.version != COMPRESSED_GRAPH_VERSION) {
+        fprintf(stderr, "Unsupported compressed graph file version %d.\n", header.version);
+        exit(1);
+    }
+
+    if (header.num_edges > std::numeric_limits<EdgeIndex>::max()) {
+        fprintf(stderr, "Graph has %lld edges; rebuild with EDGES64=1 to load it.\n",
+                (long long) header.num_edges);
+        exit(1);
+    }
+
+    compressed_graph* cg = (compressed_graph*)calloc(1, sizeof(compressed_graph));
+    size_t n = header.num_nodes;
+
+    cg->num_nodes = header.num_nodes;
+    cg->num_edges = (EdgeIndex) header.num_edges;
+    cg->outgoing_offsets = (int64_t*)malloc(sizeof(int64_t) * (n + 1));
+    cg->outgoing_data = (uint8_t*)malloc(std::max<int64_t>(header.outgoing_bytes, 1));
+    cg->outgoing_degrees = (int*)malloc(sizeof(int) * n);
+    cg->incoming_offsets = (int64_t*)malloc(sizeof(int64_t) * (n + 1));
+    cg->incoming_data = (uint8_t*)malloc(std::max<int64_t>(header.incoming_bytes, 1));
+
+    read_array(input, cg->outgoing_offsets, sizeof(int64_t) * (n + 1), "outgoing offsets");
+    read_array(input, cg->outgoing_data, header.outgoing_bytes, "outgoing edges");
+    read_array(input, cg->outgoing_degrees, sizeof(int) * n, "outgoing degrees");
+    read_array(input, cg->incoming_offsets, sizeof(int64_t) * (n + 1), "incoming offsets");
+    read_array(input, cg->incoming_data, header.incoming_bytes, "incoming edges");
+
+    fclose(input);
+
+    if (cg->outgoing_offsets[n] != header.outgoing_bytes || cg->incoming_offsets[n] != header.incoming_bytes) {
+        fprintf(stderr, "Invalid compressed graph offsets. File may be corrupt.\n");
+        exit(1);
+    }
+
+    return cg;
+}
+
+void store_compressed_graph(const char* filename, const CompressedGraph cg)
+{
+    FILE* output = fopen(filename, "wb");
+
+    if (!output) {
+        fprintf(stderr, "Could not open: %s\n", filename);
+        exit(1);
+    }
+
+    size_t n = cg->num_nodes;
+
+    compressed_graph_header header;
+    memset(&header, 0, sizeof(header));
+    header.token = COMPRESSED_GRAPH_HEADER_TOKEN;
+    header.version = COMPRESSED_GRAPH_VERSION;
+    header.num_nodes = cg->num_nodes;
+    header.num_edges = cg->num_edges;
+    header.outgoing_bytes = cg->outgoing_offsets[n];
+    header.incoming_bytes = cg->incoming_offsets[n];
+
+    write_array(output, &header, sizeof(header), "header");
+    write_array(output, cg->outgoing_offsets, sizeof(int64_t) * (n + 1), "outgoing offsets");
+    write_array(output, cg->outgoing_data, header.outgoing_bytes, "outgoing edges");
+    write_array(output, cg->outgoing_degrees, sizeof(int) * n, "outgoing degrees");
+    write_array(output, cg->incoming_offsets, sizeof(int64_t) * (n + 1), "incoming offsets");
+    write_array(output, cg->incoming_data, header.incoming_bytes, "incoming edges");
+
+    fclose(output);
+}
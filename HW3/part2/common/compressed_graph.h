@@ -0,0 +1,143 @@
+#ifndef __COMPRESSED_GRAPH_H__
+#define __COMPRESSED_GRAPH_H__
+
+#include <stdint.h>
+
+#include "graph.h"
+
+// Compressed CSR.  Every neighbor list is stored sorted, as the
+// zigzag-encoded distance of the first neighbor from the vertex itself
+// followed by the gaps between consecutive neighbors.  Each value is a
+// LEB128 varint: 7 bits per byte, high bit set on all but the last byte.
+// On power-law graphs most gaps fit in one byte instead of four.
+struct compressed_graph
+{
+    EdgeIndex num_edges;
+    int num_nodes;
+
+    // The encoded out-list of vertex v is
+    // outgoing_data[outgoing_offsets[v] .. outgoing_offsets[v + 1]).
+    // Both offset arrays have num_nodes + 1 entries.
+    int64_t* outgoing_offsets;
+    uint8_t* outgoing_data;
+    int* outgoing_degrees;
+
+    int64_t* incoming_offsets;
+    uint8_t* incoming_data;
+};
+
+using CompressedGraph = compressed_graph*;
+
+// Forward iterator decoding one neighbor list.  outgoing_begin() and
+// friends below return these, so kernels written against the Graph
+// accessors with `auto` iterators work on either representation.
+class neighbor_iterator
+{
+public:
+    neighbor_iterator(const uint8_t* pos, const uint8_t* end, Vertex base)
+        : pos_(pos), next_(pos), end_(end), value_(base)
+    {
+        if (pos_ != end_)
+            value_ = base + unzigzag(read_varint());
+    }
+
+    Vertex operator*() const { return value_; }
+
+    neighbor_iterator& operator++()
+    {
+        pos_ = next_;
+        if (pos_ != end_)
+            value_ += (Vertex) read_varint();
+        return *this;
+    }
+
+    neighbor_iterator operator++(int)
+    {
+        neighbor_iterator old = *this;
+        ++*this;
+        return old;
+    }
+
+    bool operator==(const neighbor_iterator& other) const { return pos_ == other.pos_; }
+    bool operator!=(const neighbor_iterator& other) const { return pos_ != other.pos_; }
+
+private:
+    // decodes the varint at pos_ and points next_ past it
+    uint32_t read_varint()
+    {
+        const uint8_t* p = pos_;
+        uint32_t value = *p & 0x7f;
+        int shift = 7;
+        while (*p++ & 0x80) {
+            value |= (uint32_t)(*p & 0x7f) << shift;
+            shift += 7;
+        }
+        next_ = p;
+        return value;
+    }
+
+    static Vertex unzigzag(uint32_t v)
+    {
+        return (Vertex)(v >> 1) ^ -(Vertex)(v & 1);
+    }
+
+    const uint8_t* pos_;
+    const uint8_t* next_;
+    const uint8_t* end_;
+    Vertex value_;
+};
+
+/* Getters */
+static inline int num_nodes(const CompressedGraph g)
+{
+    return g->num_nodes;
+}
+
+static inline EdgeIndex num_edges(const CompressedGraph g)
+{
+    return g->num_edges;
+}
+
+static inline neighbor_iterator outgoing_begin(const CompressedGraph g, Vertex v)
+{
+    return neighbor_iterator(g->outgoing_data + g->outgoing_offsets[v],
+                             g->outgoing_data + g->outgoing_offsets[v + 1], v);
+}
+
+static inline neighbor_iterator outgoing_end(const CompressedGraph g, Vertex v)
+{
+    const uint8_t* end = g->outgoing_data + g->outgoing_offsets[v + 1];
+    return neighbor_iterator(end, end, v);
+}
+
+static inline int outgoing_size(const CompressedGraph g, Vertex v)
+{
+    return g->outgoing_degrees[v];
+}
+
+static inline neighbor_iterator incoming_begin(const CompressedGraph g, Vertex v)
+{
+    return neighbor_iterator(g->incoming_data + g->incoming_offsets[v],
+                             g->incoming_data + g->incoming_offsets[v + 1], v);
+}
+
+static inline neighbor_iterator incoming_end(const CompressedGraph g, Vertex v)
+{
+    const uint8_t* end = g->incoming_data + g->incoming_offsets[v + 1];
+    return neighbor_iterator(end, end, v);
+}
+
+
+/* Construction and IO */
+CompressedGraph compress_graph(const Graph);
+CompressedGraph load_compressed_graph(const char* filename);
+void store_compressed_graph(const char* filename, const CompressedGraph);
+
+// Bytes used by the encoded neighbor lists, offsets and degrees
+size_t compressed_graph_bytes(const CompressedGraph);
+
+
+/* Deallocation */
+void free_compressed_graph(CompressedGraph);
+
+#endif
@@ -1,186 +1,505 @@
+#include <algorithm>
+#include <vector>
 #include <string>
 #include <iostream>
-#include <fstream>
-#include <sstream>
 #include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <stdint.h>
+#include <omp.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "graph.h"
 #include "graph_internal.h"
 
 #define GRAPH_HEADER_TOKEN ((int) 0xDEADBEEF)
 
+// Mapped graph files (see store_graph_mapped) start with their own token
+// so both loaders can tell them apart from the original format.
+#define GRAPH_MAPPED_HEADER_TOKEN ((int) 0xDEADBEE2)
+#define GRAPH_MAPPED_VERSION 4
+#define GRAPH_MAPPED_ALIGNMENT 4096
+
+// Original-format files of weighted graphs carry this token and
+// num_edges weights after the edge array.  Readers that predate weights
+// stop after the edges and never see them.  (0xDEADBEE3 starts
+// compressed graph files, see compressed_graph.cpp.)
+#define GRAPH_WEIGHTS_TOKEN ((int) 0xDEADBEE4)
+
+struct mapped_graph_header
+{
+    int token;
+    int version;
+    int num_nodes;
+    // Size in bytes of each entry of the two starts arrays (4 or 8)
+    int edge_index_size;
+    int64_t num_edges;
+
+    // Byte offsets of the CSR arrays from the start of the file.  Each
+    // is a multiple of GRAPH_MAPPED_ALIGNMENT.
+    int64_t outgoing_starts_offset;
+    int64_t outgoing_edges_offset;
+    int64_t incoming_starts_offset;
+    int64_t incoming_edges_offset;
+    // 0 for unweighted graphs.  Version 3 files end the header before
+    // this field and are read as unweighted.
+    int64_t outgoing_weights_offset;
+};
+
+// Version 2 files have 32-bit counts and offsets.  They are still
+// accepted and converted to the current header on load.
+struct mapped_graph_header_v2
+{
+    int token;
+    int version;
+    int num_nodes;
+    int num_edges;
+
+    int64_t outgoing_starts_offset;
+    int64_t outgoing_edges_offset;
+    int64_t incoming_starts_offset;
+    int64_t incoming_edges_offset;
+};
+
+
+// True if p points into the file mapping of a graph returned by
+// load_graph_mmap().  The starts arrays are converted into malloc'd
+// copies when the file's offset width differs from EdgeIndex.
+static bool in_mapping(const graph* graph, const void* p)
+{
+  const char* base = (const char*) graph->mapped_base;
+  return (const char*) p >= base && (const char*) p < base + graph->mapped_size;
+}
 
 void free_graph(Graph graph)
 {
+  if (graph->mapped_base) {
+    if (graph->num_nodes > 0 && !in_mapping(graph, graph->outgoing_starts))
+      free(graph->outgoing_starts);
+    if (graph->num_nodes > 0 && !in_mapping(graph, graph->incoming_starts))
+      free(graph->incoming_starts);
+    if (graph->outgoing_weights && !in_mapping(graph, graph->outgoing_weights))
+      free(graph->outgoing_weights);
+    munmap(graph->mapped_base, graph->mapped_size);
+    free(graph);
+    return;
+  }
+
   free(graph->outgoing_starts);
   free(graph->outgoing_edges);
 
   free(graph->incoming_starts);
   free(graph->incoming_edges);
+  free(graph->outgoing_weights);
   free(graph);
 }
 
 
-void build_start(graph* graph, int* scratch)
+// Exclusive prefix sum of in[0..n) into out[0..n) (in and out may
+// alias).  Returns the total.  Each thread scans a contiguous chunk
+// after a serial scan of the per-chunk sums.
+template <typename T>
+static T parallel_exclusive_scan(const T* in, T* out, int n)
 {
-  int num_nodes = graph->num_nodes;
-  graph->outgoing_starts = (int*)malloc(sizeof(int) * num_nodes);
-  for(int i = 0; i < num_nodes; i++)
-  {
-    graph->outgoing_starts[i] = scratch[i];
-  }
+    int num_chunks = omp_get_max_threads();
+    T* chunk_sums = (T*)malloc(sizeof(T) * (num_chunks + 1));
+    int team_size = 1;
+
+    // the team may be smaller than num_chunks; only its nt chunk sums
+    // are written
+    #pragma omp parallel num_threads(num_chunks)
+    {
+        int t = omp_get_thread_num();
+        int nt = omp_get_num_threads();
+        int begin = (int)((int64_t) n * t / nt);
+        int end = (int)((int64_t) n * (t + 1) / nt);
+
+        T sum = 0;
+        for (int i = begin; i < end; i++)
+            sum += in[i];
+        chunk_sums[t + 1] = sum;
+
+        #pragma omp barrier
+        #pragma omp single
+        {
+            chunk_sums[0] = 0;
+            for (int i = 0; i < nt; i++)
+                chunk_sums[i + 1] += chunk_sums[i];
+            team_size = nt;
+        }
+
+        T running = chunk_sums[t];
+        for (int i = begin; i < end; i++) {
+            T v = in[i];
+            out[i] = running;
+            running += v;
+        }
+    }
+
+    T total = chunk_sums[team_size];
+    free(chunk_sums);
+    return total;
 }
 
-void build_edges(graph* graph, int* scratch)
+// Given an outgoing edge adjacency list representation for a directed
+// graph, build an incoming adjacency list representation.
+//
+// This is a parallel transpose.  Source vertices are split into one
+// block per thread of roughly equal edge count, and every block gets its
+// own histogram of target vertices.  Scanning the histograms
+// target-major gives each (target, block) pair its own output range, so
+// blocks scatter without atomics and every in-neighbor list comes out
+// sorted, exactly as the serial count/scan/scatter produced it.
+//
+// The histograms take threads x vertices entries.  When that is more
+// than the edge array (and TRANSPOSE_MIN_HISTOGRAM), the average degree
+// is below the thread count, and build_incoming_edges_tiled does the
+// same with per-tile counts instead.
+#define TRANSPOSE_MIN_HISTOGRAM (1 << 22)
+
+// Target vertices per tile of build_incoming_edges_tiled: the in-list
+// offsets of a tile fit in a core's cache.
+#define TRANSPOSE_TILE (1 << 16)
+
+// Transpose of low-degree graphs.  Targets are cut into tiles of
+// TRANSPOSE_TILE vertices.  One sweep over the edges counts every
+// block's edges into each tile, and a second moves them, as (source,
+// target) pairs, into tile order: by tile, then block, then source.
+// That puts each tile's edges in the range its in-lists take in
+// incoming_edges, so one thread per tile then counts, scans and
+// scatters them in place.  Sources stay in increasing order within a
+// tile, so every in-list comes out sorted, as in the histogram
+// transpose.
+static void build_incoming_edges_tiled(graph* graph, int num_blocks, const int* block_begin)
 {
-  int num_nodes = graph->num_nodes;
-  graph->outgoing_edges = (int*)malloc(sizeof(int) * graph->num_edges);
-  for(int i = 0; i < graph->num_edges; i++)
-  {
-    graph->outgoing_edges[i] = scratch[num_nodes + i];
-  }
+    int num_nodes = graph->num_nodes;
+    EdgeIndex num_edges = graph->num_edges;
+    int num_tiles = (num_nodes + TRANSPOSE_TILE - 1) / TRANSPOSE_TILE;
+
+    // tile_counts[b * num_tiles + t]: edges of block b into tile t,
+    // then their first slot in tile order
+    EdgeIndex* tile_counts = (EdgeIndex*)calloc((size_t) num_blocks * num_tiles, sizeof(EdgeIndex));
+    EdgeIndex* tile_starts = (EdgeIndex*)malloc(sizeof(EdgeIndex) * (num_tiles + 1));
+    Vertex* targets = (Vertex*)malloc(sizeof(Vertex) * num_edges);
+
+    #pragma omp parallel for schedule(static, 1)
+    for (int b = 0; b < num_blocks; b++) {
+        EdgeIndex* counts = tile_counts + (size_t) b * num_tiles;
+        EdgeIndex start_edge = (block_begin[b] == num_nodes) ? num_edges : graph->outgoing_starts[block_begin[b]];
+        EdgeIndex end_edge = (block_begin[b + 1] == num_nodes) ? num_edges : graph->outgoing_starts[block_begin[b + 1]];
+        for (EdgeIndex j = start_edge; j < end_edge; j++)
+            counts[graph->outgoing_edges[j] / TRANSPOSE_TILE]++;
+    }
+
+    EdgeIndex running = 0;
+    for (int t = 0; t < num_tiles; t++) {
+        tile_starts[t] = running;
+        for (int b = 0; b < num_blocks; b++) {
+            EdgeIndex count = tile_counts[(size_t) b * num_tiles + t];
+            tile_counts[(size_t) b * num_tiles + t] = running;
+            running += count;
+        }
+    }
+    tile_starts[num_tiles] = running;
+
+    #pragma omp parallel for schedule(static, 1)
+    for (int b = 0; b < num_blocks; b++) {
+        EdgeIndex* cursor = tile_counts + (size_t) b * num_tiles;
+        for (int i = block_begin[b]; i < block_begin[b + 1]; i++) {
+            EdgeIndex start_edge = graph->outgoing_starts[i];
+            EdgeIndex end_edge = (i == num_nodes - 1) ? num_edges : graph->outgoing_starts[i + 1];
+            for (EdgeIndex j = start_edge; j < end_edge; j++) {
+                Vertex target = graph->outgoing_edges[j];
+                EdgeIndex at = cursor[target / TRANSPOSE_TILE]++;
+                graph->incoming_edges[at] = i;
+                targets[at] = target;
+            }
+        }
+    }
+
+    #pragma omp parallel
+    {
+        std::vector<Vertex> sources;
+
+        #pragma omp for schedule(dynamic, 1)
+        for (int t = 0; t < num_tiles; t++) {
+            int tile_begin = t * TRANSPOSE_TILE;
+            int tile_len = std::min(TRANSPOSE_TILE, num_nodes - tile_begin);
+            EdgeIndex begin = tile_starts[t];
+            EdgeIndex end = tile_starts[t + 1];
+            EdgeIndex* starts = graph->incoming_starts + tile_begin;
+
+            for (int v = 0; v < tile_len; v++)
+                starts[v] = 0;
+            for (EdgeIndex e = begin; e < end; e++)
+                starts[targets[e] - tile_begin]++;
+
+            EdgeIndex offset = begin;
+            for (int v = 0; v < tile_len; v++) {
+                EdgeIndex count = starts[v];
+                starts[v] = offset;
+                offset += count;
+            }
+
+            // scatter with starts as cursors, then shift them back
+            sources.assign(graph->incoming_edges + begin, graph->incoming_edges + end);
+            for (EdgeIndex e = begin; e < end; e++)
+                graph->incoming_edges[starts[targets[e] - tile_begin]++] = sources[e - begin];
+            for (int v = tile_len - 1; v > 0; v--)
+                starts[v] = starts[v - 1];
+            starts[0] = begin;
+        }
+    }
+
+    free(tile_counts);
+    free(tile_starts);
+    free(targets);
 }
 
-// Given an outgoing edge adjacency list representation for a directed
-// graph, build an incoming adjacency list representation
 void build_incoming_edges(graph* graph) {
 
-    //printf("Beginning build_incoming... (%d nodes)\n", graph->num_nodes);
-
     int num_nodes = graph->num_nodes;
-    int* node_counts = (int*)malloc(sizeof(int) * num_nodes);
-    int* node_scatter = (int*)malloc(sizeof(int) * num_nodes);
-
-    graph->incoming_starts = (int*)malloc(sizeof(int) * num_nodes);
-    graph->incoming_edges = (int*)malloc(sizeof(int) * graph->num_edges);
-
-    for (int i=0; i<num_nodes; i++)
-        node_counts[i] = node_scatter[i] = 0;
-
-    int total_edges = 0;
-    // compute number of incoming edges per node
-    for (int i=0; i<num_nodes; i++) {
-        int start_edge = graph->outgoing_starts[i];
-        int end_edge = (i == graph->num_nodes-1) ? graph->num_edges : graph->outgoing_starts[i+1];
-        for (int j=start_edge; j<end_edge; j++) {
-            int target_node = graph->outgoing_edges[j];
-            node_counts[target_node]++;
-            total_edges++;
-        }
+    EdgeIndex num_edges = graph->num_edges;
+
+    graph->incoming_starts = (EdgeIndex*)malloc(sizeof(EdgeIndex) * num_nodes);
+    graph->incoming_edges = (Vertex*)malloc(sizeof(Vertex) * num_edges);
+
+    if (num_nodes == 0)
+        return;
+
+    int num_blocks = omp_get_max_threads();
+    int* block_begin = (int*)malloc(sizeof(int) * (num_blocks + 1));
+
+    // block b owns the sources whose first edge falls in the b-th
+    // slice of the edge array
+    block_begin[0] = 0;
+    for (int b = 1; b < num_blocks; b++) {
+        EdgeIndex first_edge = (EdgeIndex)((int64_t) num_edges * b / num_blocks);
+        block_begin[b] = std::lower_bound(graph->outgoing_starts,
+                                          graph->outgoing_starts + num_nodes,
+                                          first_edge) - graph->outgoing_starts;
     }
-    //printf("Total edges: %d\n", total_edges);
-    //printf("Computed incoming edge counts.\n");
+    block_begin[num_blocks] = num_nodes;
 
-    // build the starts array
-    graph->incoming_starts[0] = 0;
-    for (int i=1; i<num_nodes; i++) {
-        graph->incoming_starts[i] = graph->incoming_starts[i-1] + node_counts[i-1];
-        //printf("%d: %d ", i, graph->incoming_starts[i]);
+    if ((int64_t) num_blocks * num_nodes > std::max<int64_t>(num_edges, TRANSPOSE_MIN_HISTOGRAM)) {
+        build_incoming_edges_tiled(graph, num_blocks, block_begin);
+        free(block_begin);
+        return;
     }
-    //printf("\n");
-    //printf("Last edge=%d\n", graph->incoming_starts[num_nodes-1] + node_counts[num_nodes-1]);
 
-    //printf("Computed per-node incoming starts.\n");
+    int** histograms = (int**)malloc(sizeof(int*) * num_blocks);
+
+    // count incoming edges per target, one histogram per block, each
+    // allocated by the thread that counts into it
+    #pragma omp parallel for schedule(static, 1)
+    for (int b = 0; b < num_blocks; b++) {
+        int* hist = (int*)calloc(num_nodes, sizeof(int));
+        histograms[b] = hist;
 
-    // now perform the scatter
-    for (int i=0; i<num_nodes; i++) {
-        int start_edge = graph->outgoing_starts[i];
-        int end_edge = (i == graph->num_nodes-1) ? graph->num_edges : graph->outgoing_starts[i+1];
-        for (int j=start_edge; j<end_edge; j++) {
-            int target_node = graph->outgoing_edges[j];
-            graph->incoming_edges[graph->incoming_starts[target_node] + node_scatter[target_node]] = i;
-            node_scatter[target_node]++;
+        EdgeIndex start_edge = (block_begin[b] == num_nodes) ? num_edges : graph->outgoing_starts[block_begin[b]];
+        EdgeIndex end_edge = (block_begin[b + 1] == num_nodes) ? num_edges : graph->outgoing_starts[block_begin[b + 1]];
+        for (EdgeIndex j = start_edge; j < end_edge; j++)
+            hist[graph->outgoing_edges[j]]++;
+    }
+
+    // turn each histogram entry into the offset of its block's run
+    // within the target's in-list, and total the in-degrees
+    EdgeIndex* node_counts = graph->incoming_starts;
+    #pragma omp parallel for
+    for (int v = 0; v < num_nodes; v++) {
+        int running = 0;
+        for (int b = 0; b < num_blocks; b++) {
+            int count = histograms[b][v];
+            histograms[b][v] = running;
+            running += count;
         }
+        node_counts[v] = running;
     }
 
-    /*
-    // verify
-    printf("Verifying graph...\n");
+    parallel_exclusive_scan(node_counts, node_counts, num_nodes);
+
+    // scatter: sources are visited in increasing order within a block,
+    // and block runs are laid out in block order
+    #pragma omp parallel for schedule(static, 1)
+    for (int b = 0; b < num_blocks; b++) {
+        int* hist = histograms[b];
+        for (int i = block_begin[b]; i < block_begin[b + 1]; i++) {
+            EdgeIndex start_edge = graph->outgoing_starts[i];
+            EdgeIndex end_edge = (i == num_nodes - 1) ? num_edges : graph->outgoing_starts[i + 1];
+            for (EdgeIndex j = start_edge; j < end_edge; j++) {
+                Vertex target = graph->outgoing_edges[j];
+                graph->incoming_edges[node_counts[target] + hist[target]++] = i;
+            }
+        }
+    }
 
-    for (int i=0; i<num_nodes; i++) {
-        int outgoing_starts = graph->outgoing_starts[i];
-        int end_node = (i == graph->num_nodes-1) ? graph->num_edges : graph->outgoing_starts[i+1];
-        for (int j=outgoing_starts; j<end_node; j++) {
+    for (int b = 0; b < num_blocks; b++)
+        free(histograms[b]);
+    free(histograms);
+    free(block_begin);
+}
 
-            bool verified = false;
+// Text graphs are parsed from a read-only mapping of the file.  After
+// the header, the body is split into one chunk per thread at line
+// boundaries.  A first pass counts the integers in every chunk, a scan
+// over the counts gives each chunk its first output index, and a second
+// pass parses every chunk straight into the graph arrays.
 
-            // make sure that i is a neighbor of target_node
-            int target_node = graph->outgoing_edges[j];
-            int j_start_edge = graph->incoming_starts[target_node];
-            int j_end_edge = (target_node == graph->num_nodes-1) ? graph->num_edges : graph->incoming_starts[target_node+1];
-            for (int k=j_start_edge; k<j_end_edge; k++) {
-                if (graph->incoming_edges[k] == i) {
-                    verified = true;
-                    break;
-                }
-            }
+static inline bool is_digit(char c)
+{
+  return c >= '0' && c <= '9';
+}
 
-            if (!verified) {
-                fprintf(stderr,"Error: %d,%d did not verify\n", i, target_node);
-            }
-        }
+// Returns the start of the line after the one containing p.
+static const char* skip_line(const char* p, const char* end)
+{
+  p = (const char*) memchr(p, '\n', end - p);
+  return p ? p + 1 : end;
+}
+
+// Returns the next line that is neither empty nor a '#' comment,
+// starting at *p, and advances *p past it.
+static std::string next_content_line(const char** p, const char* end)
+{
+  while (*p < end) {
+    const char* line = *p;
+    *p = skip_line(line, end);
+
+    const char* line_end = *p;
+    while (line_end > line && (line_end[-1] == '\n' || line_end[-1] == '\r'))
+      line_end--;
+
+    if (line_end > line && line[0] != '#')
+      return std::string(line, line_end);
+  }
+  return std::string();
+}
+
+// Calls emit(value) for each integer in [p, end), skipping lines that
+// start with '#'.  p must be at the start of a line.
+template <typename Emit>
+static void scan_integers(const char* p, const char* end, Emit emit)
+{
+  bool line_start = true;
+  while (p < end) {
+    char c = *p;
+
+    if (line_start && c == '#') {
+      p = skip_line(p, end);
+      continue;
     }
 
-    printf("Done verifying\n");
-    */
+    if (is_digit(c) || (c == '-' && p + 1 < end && is_digit(p[1]))) {
+      bool negative = (c == '-');
+      if (negative)
+        p++;
+
+      int64_t v = 0;
+      while (p < end && is_digit(*p)) {
+        v = v * 10 + (*p - '0');
+        p++;
+      }
+      emit(negative ? -v : v);
+      line_start = false;
+      continue;
+    }
 
-    free(node_counts);
-    free(node_scatter);
+    line_start = (c == '\n');
+    p++;
+  }
 }
 
-void get_meta_data(std::ifstream& file, graph* graph)
+// Parses the AdjacencyGraph header and returns the start of the body.
+static const char* parse_text_header(const char* p, const char* end, graph* graph)
 {
-  // going back to the beginning of the file
-  file.clear();
-  file.seekg(0, std::ios::beg);
-  std::string buffer;
-  std::getline(file, buffer);
-  if ((buffer.compare(std::string("AdjacencyGraph"))))
+  const char* line_end = skip_line(p, end);
+  std::string first(p, line_end);
+  while (!first.empty() && (first.back() == '\n' || first.back() == '\r'))
+    first.pop_back();
+
+  if (first.compare("AdjacencyGraph"))
   {
-    std::cout << "Invalid input file" << buffer << std::endl;
+    std::cout << "Invalid input file" << first << std::endl;
     exit(1);
   }
-  buffer.clear();
-
-  do {
-      std::getline(file, buffer);
-  } while (buffer.size() == 0 || buffer[0] == '#');
-
-  graph->num_nodes = atoi(buffer.c_str());
-  buffer.clear();
+  p = line_end;
 
-  do {
-      std::getline(file, buffer);
-  } while (buffer.size() == 0 || buffer[0] == '#');
+  graph->num_nodes = atoi(next_content_line(&p, end).c_str());
 
-  graph->num_edges = atoi(buffer.c_str());
+  long long num_edges = atoll(next_content_line(&p, end).c_str());
+  if (num_edges > std::numeric_limits<EdgeIndex>::max()) {
+    std::cout << "Graph has " << num_edges << " edges; rebuild with EDGES64=1 to load it" << std::endl;
+    exit(1);
+  }
+  graph->num_edges = (EdgeIndex) num_edges;
 
+  return p;
 }
 
-void read_graph_file(std::ifstream& file, int* scratch)
+// Reads the vertex starts followed by the edge targets in [body, end)
+// into the (already allocated) outgoing arrays of graph.
+static void read_graph_body(const char* body, const char* end, graph* graph)
 {
-  std::string buffer;
-  int idx = 0;
-  while(!file.eof())
+  int num_chunks = omp_get_max_threads();
+  const char** chunk_begin = (const char**)malloc(sizeof(const char*) * (num_chunks + 1));
+  int64_t* chunk_first = (int64_t*)malloc(sizeof(int64_t) * (num_chunks + 1));
+
+  // chunks start at line boundaries so '#' comments are seen whole
+  chunk_begin[0] = body;
+  for (int c = 1; c < num_chunks; c++) {
+    const char* split = body + (end - body) * c / num_chunks;
+    chunk_begin[c] = std::max(chunk_begin[c - 1], (split == body) ? body : skip_line(split - 1, end));
+  }
+  chunk_begin[num_chunks] = end;
+
+  int64_t num_nodes = graph->num_nodes;
+  int64_t num_values = num_nodes + graph->num_edges;
+
+  // the team may be smaller than num_chunks (thread limits, nested
+  // regions), so every thread takes chunks t, t + nt, ...
+  #pragma omp parallel num_threads(num_chunks)
   {
-    buffer.clear();
-    std::getline(file, buffer);
+    int t = omp_get_thread_num();
+    int nt = omp_get_num_threads();
 
-    if (buffer.size() > 0 && buffer[0] == '#')
-        continue;
+    for (int c = t; c < num_chunks; c += nt) {
+      int64_t count = 0;
+      scan_integers(chunk_begin[c], chunk_begin[c + 1], [&](int64_t) { count++; });
+      chunk_first[c + 1] = count;
+    }
 
-    std::stringstream parse(buffer);
-    while (!parse.fail()) {
-        int v;
-        parse >> v;
-        if (parse.fail())
-        {
-            break;
-        }
-        scratch[idx] = v;
+    #pragma omp barrier
+    #pragma omp single
+    {
+      chunk_first[0] = 0;
+      for (int i = 0; i < num_chunks; i++)
+        chunk_first[i + 1] += chunk_first[i];
+    }
+
+    for (int c = t; c < num_chunks; c += nt) {
+      int64_t idx = chunk_first[c];
+      scan_integers(chunk_begin[c], chunk_begin[c + 1], [&](int64_t v) {
+        if (idx < num_nodes)
+          graph->outgoing_starts[idx] = (EdgeIndex) v;
+        else if (idx < num_values)
+          graph->outgoing_edges[idx - num_nodes] = (Vertex) v;
         idx++;
+      });
     }
   }
+
+  if (chunk_first[num_chunks] < num_values) {
+    fprintf(stderr, "Text graph ends early: expected %lld values, found %lld.\n",
+            (long long) num_values, (long long) chunk_first[num_chunks]);
+    exit(1);
+  }
+
+  free(chunk_begin);
+  free(chunk_first);
 }
 
 void print_graph(const graph* graph)
@@ -188,14 +507,14 @@ void print_graph(const graph* graph)
 
     printf("Graph pretty print:\n");
     printf("num_nodes=%d\n", graph->num_nodes);
-    printf("num_edges=%d\n", graph->num_edges);
+    printf("num_edges=%lld\n", (long long) graph->num_edges);
 
     for (int i=0; i<graph->num_nodes; i++) {
 
-        int start_edge = graph->outgoing_starts[i];
-        int end_edge = (i == graph->num_nodes-1) ? graph->num_edges : graph->outgoing_starts[i+1];
-        printf("node %02d: out=%d: ", i, end_edge - start_edge);
-        for (int j=start_edge; j<end_edge; j++) {
+        EdgeIndex start_edge = graph->outgoing_starts[i];
+        EdgeIndex end_edge = (i == graph->num_nodes-1) ? graph->num_edges : graph->outgoing_starts[i+1];
+        printf("node %02d: out=%d: ", i, (int)(end_edge - start_edge));
+        for (EdgeIndex j=start_edge; j<end_edge; j++) {
             int target = graph->outgoing_edges[j];
             printf("%d ", target);
         }
@@ -203,8 +522,8 @@ void print_graph(const graph* graph)
 
         start_edge = graph->incoming_starts[i];
         end_edge = (i == graph->num_nodes-1) ? graph->num_edges : graph->incoming_starts[i+1];
-        printf("         in=%d: ", end_edge - start_edge);
-        for (int j=start_edge; j<end_edge; j++) {
+        printf("         in=%d: ", (int)(end_edge - start_edge));
+        for (EdgeIndex j=start_edge; j<end_edge; j++) {
             int target = graph->incoming_edges[j];
             printf("%d ", target);
         }
@@ -214,19 +533,35 @@ void print_graph(const graph* graph)
 
 Graph load_graph(const char* filename)
 {
-  graph* graph = (struct graph*)(malloc(sizeof(struct graph)));
+  graph* graph = (struct graph*)(calloc(1, sizeof(struct graph)));
+
+  // map the file
+  int fd = open(filename, O_RDONLY);
+  struct stat st;
+
+  if (fd < 0 || fstat(fd, &st) != 0) {
+    fprintf(stderr, "Could not open: %s\n", filename);
+    exit(1);
+  }
+
+  size_t file_size = st.st_size;
+  void* base = (file_size > 0) ? mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+  close(fd);
+
+  if (base == MAP_FAILED) {
+    fprintf(stderr, "Could not map: %s\n", filename);
+    exit(1);
+  }
+  madvise(base, file_size, MADV_SEQUENTIAL);
 
-  // open the file
-  std::ifstream graph_file;
-  graph_file.open(filename);
-  get_meta_data(graph_file, graph);
+  const char* text = (const char*) base;
+  const char* body = parse_text_header(text, text + file_size, graph);
 
-  int* scratch = (int*) malloc(sizeof(int) * (graph->num_nodes + graph->num_edges));
-  read_graph_file(graph_file, scratch);
+  graph->outgoing_starts = (EdgeIndex*) malloc(sizeof(EdgeIndex) * graph->num_nodes);
+  graph->outgoing_edges = (Vertex*) malloc(sizeof(Vertex) * graph->num_edges);
+  read_graph_body(body, text + file_size, graph);
 
-  build_start(graph, scratch);
-  build_edges(graph, scratch);
-  free(scratch);
+  munmap(base, file_size);
 
   build_incoming_edges(graph);
 
@@ -235,9 +570,160 @@ Graph load_graph(const char* filename)
   return graph;
 }
 
+static int64_t align_mapped_offset(int64_t offset)
+{
+    return (offset + GRAPH_MAPPED_ALIGNMENT - 1) / GRAPH_MAPPED_ALIGNMENT * GRAPH_MAPPED_ALIGNMENT;
+}
+
+static void check_mapped_section(int64_t offset, size_t bytes, size_t file_size, const char* what)
+{
+    if (offset < 0 || offset % GRAPH_MAPPED_ALIGNMENT != 0 ||
+        (size_t) offset > file_size || bytes > file_size - (size_t) offset) {
+        fprintf(stderr, "Invalid %s section in mapped graph file. File may be corrupt.\n", what);
+        exit(1);
+    }
+}
+
+// Decodes the header at the start of a mapped graph file (of which
+// the first sizeof(mapped_graph_header) bytes are in raw) into the
+// current header layout, and validates it against the file size.
+static mapped_graph_header parse_mapped_header(const void* raw, size_t file_size)
+{
+    mapped_graph_header header;
+    memcpy(&header, raw, sizeof(header));
+
+    if (header.token != GRAPH_MAPPED_HEADER_TOKEN) {
+        fprintf(stderr, "Invalid graph file header. File may be corrupt.\n");
+        exit(1);
+    }
+
+    if (header.version == 2) {
+        mapped_graph_header_v2 v2;
+        memcpy(&v2, raw, sizeof(v2));
+        header.edge_index_size = sizeof(int);
+        header.num_edges = v2.num_edges;
+        header.outgoing_starts_offset = v2.outgoing_starts_offset;
+        header.outgoing_edges_offset = v2.outgoing_edges_offset;
+        header.incoming_starts_offset = v2.incoming_starts_offset;
+        header.incoming_edges_offset = v2.incoming_edges_offset;
+        header.outgoing_weights_offset = 0;
+    } else if (header.version == 3) {
+        header.outgoing_weights_offset = 0;
+    } else if (header.version != GRAPH_MAPPED_VERSION) {
+        fprintf(stderr, "Unsupported mapped graph file version %d.\n", header.version);
+        exit(1);
+    }
+
+    if (header.num_nodes < 0 || header.num_edges < 0 ||
+        (header.edge_index_size != sizeof(int32_t) && header.edge_index_size != sizeof(int64_t))) {
+        fprintf(stderr, "Invalid graph size in header. File may be corrupt.\n");
+        exit(1);
+    }
+
+    if (header.num_edges > std::numeric_limits<EdgeIndex>::max()) {
+        fprintf(stderr, "Graph has %lld edges; rebuild with EDGES64=1 to load it.\n",
+                (long long) header.num_edges);
+        exit(1);
+    }
+
+    size_t starts_bytes = header.edge_index_size * (size_t) header.num_nodes;
+    size_t edges_bytes = sizeof(Vertex) * (size_t) header.num_edges;
+
+    check_mapped_section(header.outgoing_starts_offset, starts_bytes, file_size, "outgoing starts");
+    check_mapped_section(header.outgoing_edges_offset, edges_bytes, file_size, "outgoing edges");
+    check_mapped_section(header.incoming_starts_offset, starts_bytes, file_size, "incoming starts");
+    check_mapped_section(header.incoming_edges_offset, edges_bytes, file_size, "incoming edges");
+    if (header.outgoing_weights_offset != 0)
+        check_mapped_section(header.outgoing_weights_offset, sizeof(Weight) * (size_t) header.num_edges,
+                             file_size, "weights");
+
+    return header;
+}
+
+// Copies a starts array stored with entry_size-byte entries into a
+// newly allocated EdgeIndex array.
+static EdgeIndex* convert_starts(const void* src, int entry_size, int n)
+{
+    EdgeIndex* starts = (EdgeIndex*)malloc(sizeof(EdgeIndex) * n);
+
+    if (entry_size == sizeof(int32_t)) {
+        const int32_t* in = (const int32_t*) src;
+        #pragma omp parallel for
+        for (int i = 0; i < n; i++)
+            starts[i] = in[i];
+    } else {
+        const int64_t* in = (const int64_t*) src;
+        #pragma omp parallel for
+        for (int i = 0; i < n; i++)
+            starts[i] = (EdgeIndex) in[i];
+    }
+
+    return starts;
+}
+
+static void read_mapped_section(FILE* input, int64_t offset, void* dst, size_t bytes, const char* what)
+{
+    if (fseeko(input, offset, SEEK_SET) != 0 || fread(dst, 1, bytes, input) != bytes) {
+        fprintf(stderr, "Error reading %s.\n", what);
+        exit(1);
+    }
+}
+
+// Reads a starts array of n entry_size-byte entries into a newly
+// allocated EdgeIndex array.
+static EdgeIndex* read_starts(FILE* input, int64_t offset, int entry_size, int n, const char* what)
+{
+    void* raw = malloc((size_t) entry_size * n);
+    read_mapped_section(input, offset, raw, (size_t) entry_size * n, what);
+
+    if (entry_size == sizeof(EdgeIndex))
+        return (EdgeIndex*) raw;
+
+    EdgeIndex* starts = convert_starts(raw, entry_size, n);
+    free(raw);
+    return starts;
+}
+
+// Reads a mapped-format file into malloc'd buffers.  Used by
+// load_graph_binary() so existing callers can open either format.
+static void read_mapped_graph(FILE* input, graph* graph)
+{
+    char raw[sizeof(mapped_graph_header)];
+
+    struct stat st;
+    if (fstat(fileno(input), &st) != 0 ||
+        fread(raw, sizeof(raw), 1, input) != 1) {
+        fprintf(stderr, "Error reading header.\n");
+        exit(1);
+    }
+
+    mapped_graph_header header = parse_mapped_header(raw, st.st_size);
+
+    graph->num_nodes = header.num_nodes;
+    graph->num_edges = header.num_edges;
+
+    size_t edges_bytes = sizeof(Vertex) * graph->num_edges;
+
+    graph->outgoing_edges = (Vertex*)malloc(edges_bytes);
+    graph->incoming_edges = (Vertex*)malloc(edges_bytes);
+
+    graph->outgoing_starts = read_starts(input, header.outgoing_starts_offset, header.edge_index_size,
+                                         graph->num_nodes, "nodes");
+    read_mapped_section(input, header.outgoing_edges_offset, graph->outgoing_edges, edges_bytes, "edges");
+    graph->incoming_starts = read_starts(input, header.incoming_starts_offset, header.edge_index_size,
+                                         graph->num_nodes, "incoming nodes");
+    read_mapped_section(input, header.incoming_edges_offset, graph->incoming_edges, edges_bytes, "incoming edges");
+
+    if (header.outgoing_weights_offset != 0) {
+        graph->outgoing_weights = (Weight*)malloc(sizeof(Weight) * graph->num_edges);
+        read_mapped_section(input, header.outgoing_weights_offset, graph->outgoing_weights,
+                            sizeof(Weight) * graph->num_edges, "weights");
+    }
+}
+
 Graph load_graph_binary(const char* filename)
 {
-    graph* graph = (struct graph*)(malloc(sizeof(struct graph)));
+    graph* graph = (struct graph*)(calloc(1, sizeof(struct graph)));
 
     FILE* input = fopen(filename, "rb");
 
@@ -246,6 +732,21 @@ Graph load_graph_binary(const char* filename)
         exit(1);
     }
 
+    int token;
+
+    if (fread(&token, sizeof(int), 1, input) != 1) {
+        fprintf(stderr, "Error reading header.\n");
+        exit(1);
+    }
+
+    rewind(input);
+
+    if (token == GRAPH_MAPPED_HEADER_TOKEN) {
+        read_mapped_graph(input, graph);
+        fclose(input);
+        return graph;
+    }
+
     int header[3];
 
     if (fread(header, sizeof(int), 3, input) != 3) {
@@ -261,19 +762,26 @@ Graph load_graph_binary(const char* filename)
     graph->num_nodes = header[1];
     graph->num_edges = header[2];
 
-    graph->outgoing_starts = (int*)malloc(sizeof(int) * graph->num_nodes);
-    graph->outgoing_edges = (int*)malloc(sizeof(int) * graph->num_edges);
-
-    if (fread(graph->outgoing_starts, sizeof(int), graph->num_nodes, input) != (size_t) graph->num_nodes) {
-        fprintf(stderr, "Error reading nodes.\n");
-        exit(1);
-    }
+    graph->outgoing_starts = read_starts(input, ftello(input), sizeof(int), graph->num_nodes, "nodes");
+    graph->outgoing_edges = (Vertex*)malloc(sizeof(Vertex) * graph->num_edges);
 
     if (fread(graph->outgoing_edges, sizeof(int), graph->num_edges, input) != (size_t) graph->num_edges) {
         fprintf(stderr, "Error reading edges.\n");
         exit(1);
     }
 
+    if (fread(&token, sizeof(int), 1, input) == 1) {
+        if (token != GRAPH_WEIGHTS_TOKEN) {
+            fprintf(stderr, "Invalid weights section. File may be corrupt.\n");
+            exit(1);
+        }
+        graph->outgoing_weights = (Weight*)malloc(sizeof(Weight) * graph->num_edges);
+        if (fread(graph->outgoing_weights, sizeof(Weight), graph->num_edges, input) != (size_t) graph->num_edges) {
+            fprintf(stderr, "Error reading weights.\n");
+            exit(1);
+        }
+    }
+
     fclose(input);
 
     build_incoming_edges(graph);
@@ -283,6 +791,12 @@ Graph load_graph_binary(const char* filename)
 
 void store_graph_binary(const char* filename, Graph graph) {
 
+    // the original format cannot describe more than 2^31-1 edges
+    if (graph->num_edges > std::numeric_limits<int>::max()) {
+        store_graph_mapped(filename, graph);
+        return;
+    }
+
     FILE* output = fopen(filename, "wb");
 
     if (!output) {
@@ -300,15 +814,156 @@ void store_graph_binary(const char* filename, Graph graph) {
         exit(1);
     }
 
-    if (fwrite(graph->outgoing_starts, sizeof(int), graph->num_nodes, output) != (size_t) graph->num_nodes) {
+    int* starts = (int*) graph->outgoing_starts;
+    if (sizeof(EdgeIndex) != sizeof(int)) {
+        starts = (int*)malloc(sizeof(int) * graph->num_nodes);
+        for (int i = 0; i < graph->num_nodes; i++)
+            starts[i] = (int) graph->outgoing_starts[i];
+    }
+
+    if (fwrite(starts, sizeof(int), graph->num_nodes, output) != (size_t) graph->num_nodes) {
         fprintf(stderr, "Error writing nodes.\n");
         exit(1);
     }
 
+    if (starts != (int*) graph->outgoing_starts)
+        free(starts);
+
     if (fwrite(graph->outgoing_edges, sizeof(int), graph->num_edges, output) != (size_t) graph->num_edges) {
         fprintf(stderr, "Error writing edges.\n");
         exit(1);
     }
 
+    if (graph->outgoing_weights) {
+        int token = GRAPH_WEIGHTS_TOKEN;
+        if (fwrite(&token, sizeof(int), 1, output) != 1 ||
+            fwrite(graph->outgoing_weights, sizeof(Weight), graph->num_edges, output) != (size_t) graph->num_edges) {
+            fprintf(stderr, "Error writing weights.\n");
+            exit(1);
+        }
+    }
+
+    fclose(output);
+}
+
+Graph load_graph_mmap(const char* filename)
+{
+    int fd = open(filename, O_RDONLY);
+
+    if (fd < 0) {
+        fprintf(stderr, "Could not open: %s\n", filename);
+        exit(1);
+    }
+
+    struct stat st;
+    int token;
+
+    if (fstat(fd, &st) != 0 || pread(fd, &token, sizeof(int), 0) != (ssize_t) sizeof(int)) {
+        fprintf(stderr, "Error reading header.\n");
+        exit(1);
+    }
+
+    if (token != GRAPH_MAPPED_HEADER_TOKEN) {
+        close(fd);
+        return load_graph_binary(filename);
+    }
+
+    size_t file_size = st.st_size;
+    if (file_size < sizeof(mapped_graph_header)) {
+        fprintf(stderr, "Error reading header.\n");
+        exit(1);
+    }
+
+    void* base = mmap(NULL, file_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (base == MAP_FAILED) {
+        fprintf(stderr, "Could not map: %s\n", filename);
+        exit(1);
+    }
+
+    mapped_graph_header header = parse_mapped_header(base, file_size);
+
+    graph* graph = (struct graph*)(calloc(1, sizeof(struct graph)));
+    char* bytes = (char*) base;
+
+    graph->num_nodes = header.num_nodes;
+    graph->num_edges = header.num_edges;
+    graph->outgoing_starts = (EdgeIndex*)(bytes + header.outgoing_starts_offset);
+    graph->outgoing_edges = (Vertex*)(bytes + header.outgoing_edges_offset);
+    graph->incoming_starts = (EdgeIndex*)(bytes + header.incoming_starts_offset);
+    graph->incoming_edges = (Vertex*)(bytes + header.incoming_edges_offset);
+    if (header.outgoing_weights_offset != 0)
+        graph->outgoing_weights = (Weight*)(bytes + header.outgoing_weights_offset);
+
+    // offsets written by a build with a different EdgeIndex width are
+    // converted; the (much larger) edge arrays are always used in place
+    if (header.edge_index_size != sizeof(EdgeIndex) && graph->num_nodes > 0) {
+        graph->outgoing_starts = convert_starts(graph->outgoing_starts, header.edge_index_size, graph->num_nodes);
+        graph->incoming_starts = convert_starts(graph->incoming_starts, header.edge_index_size, graph->num_nodes);
+    }
+
+    graph->mapped_base = base;
+    graph->mapped_size = file_size;
+
+    return graph;
+}
+
+static void write_mapped_section(FILE* output, int64_t offset, const void* src, size_t bytes, const char* what)
+{
+    static const char zeros[GRAPH_MAPPED_ALIGNMENT] = {0};
+
+    // pad up to the (page aligned) start of the section
+    int64_t pos = ftello(output);
+    while (pos < offset) {
+        size_t pad = std::min<int64_t>(offset - pos, sizeof(zeros));
+        if (fwrite(zeros, 1, pad, output) != pad) {
+            fprintf(stderr, "Error writing %s.\n", what);
+            exit(1);
+        }
+        pos += pad;
+    }
+
+    if (fwrite(src, 1, bytes, output) != bytes) {
+        fprintf(stderr, "Error writing %s.\n", what);
+        exit(1);
+    }
+}
+
+void store_graph_mapped(const char* filename, Graph graph) {
+
+    FILE* output = fopen(filename, "wb");
+
+    if (!output) {
+        fprintf(stderr, "Could not open: %s\n", filename);
+        exit(1);
+    }
+
+    size_t starts_bytes = sizeof(EdgeIndex) * graph->num_nodes;
+    size_t edges_bytes = sizeof(Vertex) * graph->num_edges;
+
+    mapped_graph_header header;
+    memset(&header, 0, sizeof(header));
+    header.token = GRAPH_MAPPED_HEADER_TOKEN;
+    header.version = GRAPH_MAPPED_VERSION;
+    header.num_nodes = graph->num_nodes;
+    header.edge_index_size = sizeof(EdgeIndex);
+    header.num_edges = graph->num_edges;
+    header.outgoing_starts_offset = align_mapped_offset(sizeof(header));
+    header.outgoing_edges_offset = align_mapped_offset(header.outgoing_starts_offset + starts_bytes);
+    header.incoming_starts_offset = align_mapped_offset(header.outgoing_edges_offset + edges_bytes);
+    header.incoming_edges_offset = align_mapped_offset(header.incoming_starts_offset + starts_bytes);
+    if (graph->outgoing_weights)
+        header.outgoing_weights_offset = align_mapped_offset(header.incoming_edges_offset + edges_bytes);
+
+    write_mapped_section(output, 0, &header, sizeof(header), "header");
+    write_mapped_section(output, header.outgoing_starts_offset, graph->outgoing_starts, starts_bytes, "nodes");
+    write_mapped_section(output, header.outgoing_edges_offset, graph->outgoing_edges, edges_bytes, "edges");
+    write_mapped_section(output, header.incoming_starts_offset, graph->incoming_starts, starts_bytes, "incoming nodes");
+    write_mapped_section(output, header.incoming_edges_offset, graph->incoming_edges, edges_bytes, "incoming edges");
+    if (graph->outgoing_weights)
+        write_mapped_section(output, header.outgoing_weights_offset, graph->outgoing_weights,
+                             sizeof(Weight) * graph->num_edges, "weights");
+
     fclose(output);
 }
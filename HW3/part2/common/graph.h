@@ -1,30 +1,60 @@
 #ifndef __GRAPH_H__
 #define __GRAPH_H__
 
+#include <stddef.h>
+#include <stdint.h>
+
 using Vertex = int;
 
+// Type of edge counts and CSR offsets.  Vertex ids stay 32-bit either
+// way, so the edge arrays do not grow.  The default matches the layout
+// the prebuilt reference archives were compiled against; build with
+// -DGRAPH_64BIT_EDGES (make EDGES64=1) for graphs with more than
+// 2^31-1 edges.
+#ifdef GRAPH_64BIT_EDGES
+using EdgeIndex = int64_t;
+#else
+using EdgeIndex = int;
+#endif
+
+// Edge weights of weighted graphs (see outgoing_weights).
+using Weight = int;
+
 struct graph
 {
     // Number of edges in the graph
-    int num_edges;
+    EdgeIndex num_edges;
     // Number of vertices in the graph
     int num_nodes;
 
     // The node reached by vertex i's first outgoing edge is given by
     // outgoing_edges[outgoing_starts[i]].  To iterate over all
     // outgoing edges, please see the top-down bfs implementation.
-    int* outgoing_starts;
+    EdgeIndex* outgoing_starts;
     Vertex* outgoing_edges;
 
-    int* incoming_starts;
+    EdgeIndex* incoming_starts;
     Vertex* incoming_edges;
+
+    // Graphs returned by load_graph_mmap() point the four arrays above
+    // into a read-only file mapping instead of malloc'd buffers.  These
+    // record that mapping so free_graph() can unmap it; they are NULL/0
+    // for heap-allocated graphs.  New fields must stay at the end of the
+    // struct: the reference archives are compiled against the layout above.
+    void* mapped_base;
+    size_t mapped_size;
+
+    // Weight of every outgoing edge, parallel to outgoing_edges, or NULL
+    // for an unweighted graph.  Both file formats store it as an
+    // optional section that older readers skip.
+    Weight* outgoing_weights;
 };
 
 using Graph = graph*;
 
 /* Getters */
 static inline int num_nodes(const Graph);
-static inline int num_edges(const Graph);
+static inline EdgeIndex num_edges(const Graph);
 
 static inline const Vertex* outgoing_begin(const Graph, Vertex);
 static inline const Vertex* outgoing_end(const Graph, Vertex);
@@ -34,15 +64,42 @@ static inline const Vertex* incoming_begin(const Graph, Vertex);
 static inline const Vertex* incoming_end(const Graph, Vertex);
 static inline int incoming_size(const Graph, Vertex);
 
+// Weights of v's outgoing edges, in outgoing_begin() order.  Only valid
+// when g->outgoing_weights is not NULL.
+static inline const Weight* outgoing_weights_begin(const Graph, Vertex);
+
 
 /* IO */
 Graph load_graph(const char* filename);
 Graph load_graph_binary(const char* filename);
 void store_graph_binary(const char* filename, Graph);
 
+// Mapped graph files store the outgoing and incoming CSR arrays, each
+// starting on a page boundary, so load_graph_mmap() can use them in
+// place: nothing is copied or rebuilt, and processes mapping the same
+// file share one page-cache copy.  The arrays of a mapped graph are
+// read-only.  load_graph_mmap() falls back to load_graph_binary() for
+// files in the original binary format.
+//
+// The original binary format has a 32-bit header and offsets, so
+// store_graph_binary() writes graphs with more than 2^31-1 edges in
+// the mapped format instead.  Offsets in a mapped file are as wide as
+// the EdgeIndex of the build that wrote it; loading one into a build
+// with a different width converts the two offset arrays on load.
+Graph load_graph_mmap(const char* filename);
+void store_graph_mapped(const char* filename, Graph);
+
 void print_graph(const graph*);
 
 
+/* Construction */
+
+// Fills in the incoming CSR arrays of a graph whose num_nodes,
+// num_edges and outgoing arrays are set.  Every in-list comes out
+// sorted.
+void build_incoming_edges(graph*);
+
+
 /* Deallocation */
 void free_graph(Graph);
 
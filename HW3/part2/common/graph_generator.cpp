@@ -0,0 +1,298 @@
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <omp.h>
+
+#include "graph_generator.h"
+
+#define RMAT_A 0.57
+#define RMAT_B 0.19
+#define RMAT_C 0.19
+
+// R-MAT quadrant thresholds as 32-bit fractions, so one 64-bit draw
+// picks the quadrants of two recursion levels.
+static const uint32_t RMAT_AB_THRESHOLD = (uint32_t)((RMAT_A + RMAT_B) * 4294967296.0);
+static const uint32_t RMAT_A_THRESHOLD = (uint32_t)(RMAT_A * 4294967296.0);
+static const uint32_t RMAT_ABC_THRESHOLD = (uint32_t)((RMAT_A + RMAT_B + RMAT_C) * 4294967296.0);
+
+static inline uint64_t splitmix64(uint64_t* state)
+{
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Random stream of edge i: the same for every run and thread count.
+static inline uint64_t edge_stream(uint64_t seed, int64_t i)
+{
+    uint64_t state = seed;
+    return splitmix64(&state) ^ ((uint64_t) i * 0xD1B54A32D192ED03ULL);
+}
+
+// Uniform in [0, n) for n <= 2^31.
+static inline Vertex uniform_vertex(uint64_t* state, int n)
+{
+    return (Vertex)(((splitmix64(state) >> 32) * (uint64_t) n) >> 32);
+}
+
+// Bijection on [0, 2^scale): multiplications by odd constants and
+// right xor-shifts are each invertible modulo a power of two.
+static inline Vertex scramble(Vertex v, int scale, uint64_t k1, uint64_t k2)
+{
+    uint64_t mask = ((uint64_t) 1 << scale) - 1;
+    uint64_t x = (uint64_t) v;
+    x = (x * (k1 | 1) + k2) & mask;
+    x ^= x >> (scale / 2 + 1);
+    x = (x * (k2 | 1)) & mask;
+    return (Vertex) x;
+}
+
+static void check_edge_count(int64_t num_edges)
+{
+    if (num_edges > std::numeric_limits<EdgeIndex>::max()) {
+        fprintf(stderr, "Graph has %lld edges; rebuild with EDGES64=1 to generate it.\n",
+                (long long) num_edges);
+        exit(1);
+    }
+}
+
+// Builds a graph from num_slots candidate edges.  edge(i, &src, &dst)
+// fills in candidate i and returns false if it is not an edge; with
+// undirected set, every candidate also adds its reverse edge.
+//
+// The candidates are generated twice, once to count out-degrees and
+// once to scatter them, so the edge list is never stored.  As in
+// build_incoming_edges(), the slots are split into blocks, each with its
+// own degree histogram, and scanning the histograms vertex-major gives
+// every (vertex, block) pair its own output range, so the scatter needs
+// no atomics.  Each out-list is then sorted and deduplicated, and the
+// lists are compacted into the final CSR.
+template <typename EdgeFn>
+static Graph build_graph(int n, int64_t num_slots, bool undirected, EdgeFn edge)
+{
+    int num_blocks = (int) std::min<int64_t>(omp_get_max_threads(),
+                                             std::max<int64_t>(1, num_slots / std::max(n, 1)));
+
+    int** histograms = (int**)malloc(sizeof(int*) * num_blocks);
+    int* counts = (int*)malloc(sizeof(int) * std::max(n, 1));
+    int64_t* raw_starts = (int64_t*)malloc(sizeof(int64_t) * (n + 1));
+
+    #pragma omp parallel for schedule(static, 1)
+    for (int b = 0; b < num_blocks; b++) {
+        int* hist = (int*)calloc(std::max(n, 1), sizeof(int));
+        histograms[b] = hist;
+
+        int64_t begin = num_slots * b / num_blocks;
+        int64_t end = num_slots * (b + 1) / num_blocks;
+        for (int64_t i = begin; i < end; i++) {
+            Vertex src, dst;
+            if (!edge(i, &src, &dst) || src == dst)
+                continue;
+            hist[src]++;
+            if (undirected)
+                hist[dst]++;
+        }
+    }
+
+    // turn each histogram entry into the offset of its block's run
+    // within the vertex's list, and total the degrees
+    #pragma omp parallel for
+    for (int v = 0; v < n; v++) {
+        int running = 0;
+        for (int b = 0; b < num_blocks; b++) {
+            int count = histograms[b][v];
+            histograms[b][v] = running;
+            running += count;
+        }
+        counts[v] = running;
+    }
+
+    raw_starts[0] = 0;
+    for (int v = 0; v < n; v++)
+        raw_starts[v + 1] = raw_starts[v] + counts[v];
+
+    Vertex* raw_edges = (Vertex*)malloc(sizeof(Vertex) * std::max<int64_t>(raw_starts[n], 1));
+
+    #pragma omp parallel for schedule(static, 1)
+    for (int b = 0; b < num_blocks; b++) {
+        int* hist = histograms[b];
+
+        int64_t begin = num_slots * b / num_blocks;
+        int64_t end = num_slots * (b + 1) / num_blocks;
+        for (int64_t i = begin; i < end; i++) {
+            Vertex src, dst;
+            if (!edge(i, &src, &dst) || src == dst)
+                continue;
+            raw_edges[raw_starts[src] + hist[src]++] = dst;
+            if (undirected)
+                raw_edges[raw_starts[dst] + hist[dst]++] = src;
+        }
+        free(hist);
+    }
+    free(histograms);
+
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (int v = 0; v < n; v++) {
+        Vertex* begin = raw_edges + raw_starts[v];
+        Vertex* end = raw_edges + raw_starts[v + 1];
+        std::sort(begin, end);
+        counts[v] = std::unique(begin, end) - begin;
+    }
+
+    int64_t total = 0;
+    for (int v = 0; v < n; v++)
+        total += counts[v];
+    check_edge_count(total);
+
+    graph* g = (graph*)calloc(1, sizeof(graph));
+    g->num_nodes = n;
+    g->num_edges = (EdgeIndex) total;
+    g->outgoing_starts = (EdgeIndex*)malloc(sizeof(EdgeIndex) * std::max(n, 1));
+    g->outgoing_edges = (Vertex*)malloc(sizeof(Vertex) * std::max<int64_t>(total, 1));
+
+    EdgeIndex running = 0;
+    for (int v = 0; v < n; v++) {
+        g->outgoing_starts[v] = running;
+        running += counts[v];
+    }
+
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (int v = 0; v < n; v++)
+        std::copy(raw_edges + raw_starts[v], raw_edges + raw_starts[v] + counts[v],
+                  g->outgoing_edges + g->outgoing_starts[v]);
+
+    free(raw_edges);
+    free(raw_starts);
+    free(counts);
+
+    build_incoming_edges(g);
+    return g;
+}
+
+static Graph generate_rmat(const generator_params* p)
+{
+    if (p->scale < 0 || p->scale > 30 || p->edge_factor <= 0) {
+        fprintf(stderr, "R-MAT needs 0 <= scale <= 30 and a positive edge factor.\n");
+        exit(1);
+    }
+
+    int scale = p->scale;
+    int64_t num_edges = (int64_t) p->edge_factor << scale;
+    uint64_t seed = p->seed;
+
+    uint64_t key_state = seed ^ 0x5DEECE66DULL;
+    uint64_t k1 = splitmix64(&key_state);
+    uint64_t k2 = splitmix64(&key_state);
+
+    return build_graph(1 << scale, num_edges, p->undirected,
+        [=](int64_t i, Vertex* src, Vertex* dst) {
+            uint64_t state = edge_stream(seed, i);
+            Vertex u = 0, v = 0;
+            uint64_t bits = 0;
+            for (int level = 0; level < scale; level++) {
+                if (!(level & 1))
+                    bits = splitmix64(&state);
+                uint32_t r = (uint32_t) bits;
+                bits >>= 32;
+                int row = (r >= RMAT_AB_THRESHOLD);
+                // columns 0, 1, 0, 1 across the quadrant bands
+                int col = (r >= RMAT_A_THRESHOLD) ^ row ^ (r >= RMAT_ABC_THRESHOLD);
+                u |= row << level;
+                v |= col << level;
+            }
+            *src = scramble(u, scale, k1, k2);
+            *dst = scramble(v, scale, k1, k2);
+            return true;
+        });
+}
+
+static Graph generate_uniform(const generator_params* p)
+{
+    if (p->num_vertices <= 0 || p->edge_factor <= 0) {
+        fprintf(stderr, "Uniform graphs need a positive vertex count and edge factor.\n");
+        exit(1);
+    }
+
+    int n = p->num_vertices;
+    int64_t num_edges = (int64_t) p->edge_factor * n;
+    uint64_t seed = p->seed;
+
+    return build_graph(n, num_edges, p->undirected,
+        [=](int64_t i, Vertex* src, Vertex* dst) {
+            uint64_t state = edge_stream(seed, i);
+            *src = uniform_vertex(&state, n);
+            *dst = uniform_vertex(&state, n);
+            return true;
+        });
+}
+
+// Candidate 6v + k is the edge from v along axis k / 2, in the negative
+// direction for even k.  Candidates that leave the grid are skipped, so
+// a grid with dims[2] == 1 is 2D.
+static Graph generate_grid(const generator_params* p)
+{
+    int64_t n = 1;
+    for (int d = 0; d < 3; d++) {
+        if (p->dims[d] <= 0) {
+            fprintf(stderr, "Grid dimensions must be positive.\n");
+            exit(1);
+        }
+        n *= p->dims[d];
+        if (n > INT_MAX) {
+            fprintf(stderr, "Grid has more than 2^31-1 vertices.\n");
+            exit(1);
+        }
+    }
+
+    int dims[3] = { p->dims[0], p->dims[1], p->dims[2] };
+
+    return build_graph((int) n, 6 * n, false,
+        [=](int64_t i, Vertex* src, Vertex* dst) {
+            Vertex v = (Vertex)(i / 6);
+            int k = (int)(i % 6);
+            int coord[3] = { v % dims[0], (v / dims[0]) % dims[1], v / (dims[0] * dims[1]) };
+            coord[k / 2] += (k & 1) ? 1 : -1;
+            if (coord[k / 2] < 0 || coord[k / 2] >= dims[k / 2])
+                return false;
+            *src = v;
+            *dst = coord[0] + dims[0] * (coord[1] + dims[1] * coord[2]);
+            return true;
+        });
+}
+
+Graph generate_graph(const generator_params* params)
+{
+    switch (params->kind) {
+    case GENERATE_RMAT:    return generate_rmat(params);
+    case GENERATE_UNIFORM: return generate_uniform(params);
+    case GENERATE_GRID:    return generate_grid(params);
+    default:
+        fprintf(stderr, "Unknown generator %d.\n", (int) params->kind);
+        exit(1);
+    }
+}
+
+void generate_weights(Graph g, int max_weight, uint64_t seed)
+{
+    if (max_weight <= 0) {
+        fprintf(stderr, "Weights need a positive maximum.\n");
+        exit(1);
+    }
+
+    int n = num_nodes(g);
+    free(g->outgoing_weights);
+    g->outgoing_weights = (Weight*)malloc(sizeof(Weight) * std::max<EdgeIndex>(num_edges(g), 1));
+
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (int u = 0; u < n; u++) {
+        Weight* w = g->outgoing_weights + g->outgoing_starts[u];
+        for (const Vertex* v = outgoing_begin(g, u); v != outgoing_end(g, u); v++) {
+            uint64_t lo = std::min(u, *v), hi = std::max(u, *v);
+            uint64_t state = edge_stream(seed, (int64_t)((hi << 32) | lo));
+            *w++ = 1 + uniform_vertex(&state, max_weight);
+        }
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef __GRAPH_GENERATOR_H__
+#define __GRAPH_GENERATOR_H__
+
+#include <stdint.h>
+
+#include "graph.h"
+
+// Synthetic graphs for benchmarking.  Every random edge is a pure
+// function of (seed, edge index), so a graph depends only on its
+// parameters and seed, never on the number of threads that built it.
+// Self loops and duplicate edges are dropped, and neighbor lists come
+// out sorted.
+enum generator_kind
+{
+    // Graph500 Kronecker/R-MAT: 2^scale vertices, edge_factor * 2^scale
+    // edges drawn with quadrant probabilities (0.57, 0.19, 0.19, 0.05),
+    // then vertex ids scrambled so hubs are not clustered at low ids
+    GENERATE_RMAT,
+    // Erdos-Renyi G(n, m): num_vertices vertices, edges with both
+    // endpoints uniform
+    GENERATE_UNIFORM,
+    // 2D (dims[2] == 1) or 3D grid with edges to the 4 or 6 axis
+    // neighbors in both directions
+    GENERATE_GRID,
+};
+
+struct generator_params
+{
+    generator_kind kind;
+    // RMAT: vertex count is 2^scale
+    int scale;
+    // UNIFORM
+    int num_vertices;
+    // RMAT and UNIFORM: generated edges per vertex, before dropping
+    // self loops and duplicates
+    int edge_factor;
+    // GRID
+    int dims[3];
+    uint64_t seed;
+    // RMAT and UNIFORM: also add the reverse of every edge
+    bool undirected;
+};
+
+// Returns a heap-allocated graph.  Exits with a message if the graph
+// would have more than 2^31-1 edges in a build without
+// -DGRAPH_64BIT_EDGES.
+Graph generate_graph(const generator_params* params);
+
+// Gives every outgoing edge of g a weight in [1, max_weight], replacing
+// any weights it had.  The weight of (u, v) depends only on the seed and
+// the unordered pair {u, v}, so the two directions of an undirected
+// edge agree.
+void generate_weights(Graph g, int max_weight, uint64_t seed);
+
+#endif
@@ -10,7 +10,7 @@ static inline int num_nodes(const Graph graph)
   return graph->num_nodes;
 }
 
-static inline int num_edges(const Graph graph)
+static inline EdgeIndex num_edges(const Graph graph)
 {
   REQUIRES(graph != NULL);
   return graph->num_edges;
@@ -27,7 +27,7 @@ static inline const Vertex* outgoing_end(const Graph g, Vertex v)
 {
   REQUIRES(g != NULL);
   REQUIRES(0 <= v && v < num_nodes(g));
-  int offset = (v == g->num_nodes - 1) ? g->num_edges : g->outgoing_starts[v + 1];
+  EdgeIndex offset = (v == g->num_nodes - 1) ? g->num_edges : g->outgoing_starts[v + 1];
   return g->outgoing_edges + offset;
 }
 
@@ -36,9 +36,9 @@ static inline int outgoing_size(const Graph g, Vertex v)
   REQUIRES(g != NULL);
   REQUIRES(0 <= v && v < num_nodes(g));
   if (v == g->num_nodes - 1) {
-    return g->num_edges - g->outgoing_starts[v];
+    return (int)(g->num_edges - g->outgoing_starts[v]);
   } else {
-    return g->outgoing_starts[v + 1] - g->outgoing_starts[v];
+    return (int)(g->outgoing_starts[v + 1] - g->outgoing_starts[v]);
   }
 }
 
@@ -53,7 +53,7 @@ static inline const Vertex* incoming_end(const Graph g, Vertex v)
 {
   REQUIRES(g != NULL);
   REQUIRES(0 <= v && v < num_nodes(g));
-  int offset = (v == g->num_nodes - 1) ? g->num_edges : g->incoming_starts[v + 1];
+  EdgeIndex offset = (v == g->num_nodes - 1) ? g->num_edges : g->incoming_starts[v + 1];
   return g->incoming_edges + offset;
 }
 
@@ -62,10 +62,17 @@ static inline int incoming_size(const Graph g, Vertex v)
   REQUIRES(g != NULL);
   REQUIRES(0 <= v && v < num_nodes(g));
   if (v == g->num_nodes - 1) {
-    return g->num_edges - g->incoming_starts[v];
+    return (int)(g->num_edges - g->incoming_starts[v]);
   } else {
-    return g->incoming_starts[v + 1] - g->incoming_starts[v];
+    return (int)(g->incoming_starts[v + 1] - g->incoming_starts[v]);
   }
 }
 
+static inline const Weight* outgoing_weights_begin(const Graph g, Vertex v)
+{
+  REQUIRES(g != NULL && g->outgoing_weights != NULL);
+  REQUIRES(0 <= v && v < num_nodes(g));
+  return g->outgoing_weights + g->outgoing_starts[v];
+}
+
 #endif // __GRAPH_INTERNAL_H__
@@ -0,0 +1,331 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+#include <omp.h>
+
+#include "graph_reorder.h"
+
+
+static inline int total_degree(const Graph g, Vertex v)
+{
+    return outgoing_size(g, v) + incoming_size(g, v);
+}
+
+// new_id[] from a list of old ids in their new order.
+static Vertex* invert_order(const Vertex* order, int n)
+{
+    Vertex* new_id = (Vertex*)malloc(sizeof(Vertex) * std::max(n, 1));
+
+    #pragma omp parallel for
+    for (int i = 0; i < n; i++)
+        new_id[order[i]] = i;
+
+    return new_id;
+}
+
+static void degree_order(const Graph g, Vertex* order)
+{
+    int n = num_nodes(g);
+
+    #pragma omp parallel for
+    for (int v = 0; v < n; v++)
+        order[v] = v;
+
+    std::stable_sort(order, order + n, [g](Vertex a, Vertex b) {
+        return total_degree(g, a) > total_degree(g, b);
+    });
+}
+
+// Hub clustering only moves the hubs to the front, so the rest of the
+// graph keeps whatever locality its original ids had.
+static void hub_order(const Graph g, Vertex* order)
+{
+    int n = num_nodes(g);
+    double average = 2.0 * num_edges(g) / std::max(n, 1);
+
+    int next = 0;
+    for (int v = 0; v < n; v++)
+        if (total_degree(g, v) > average)
+            order[next++] = v;
+    for (int v = 0; v < n; v++)
+        if (total_degree(g, v) <= average)
+            order[next++] = v;
+}
+
+// Cuthill-McKee visits every component breadth-first from its
+// lowest-degree vertex, enqueueing the unvisited neighbors of each
+// vertex in increasing degree order.  Reversing the visit order gives
+// RCM.  Edges are treated as undirected.
+static void rcm_order(const Graph g, Vertex* order)
+{
+    int n = num_nodes(g);
+
+    std::vector<Vertex> by_degree(n);
+    for (int v = 0; v < n; v++)
+        by_degree[v] = v;
+    std::stable_sort(by_degree.begin(), by_degree.end(), [g](Vertex a, Vertex b) {
+        return total_degree(g, a) < total_degree(g, b);
+    });
+
+    std::vector<char> visited(n, 0);
+    int tail = 0;
+
+    for (int s = 0; s < n; s++) {
+        Vertex root = by_degree[s];
+        if (visited[root])
+            continue;
+
+        visited[root] = 1;
+        order[tail++] = root;
+
+        for (int head = tail - 1; head < tail; head++) {
+            Vertex u = order[head];
+            int first = tail;
+
+            for (const Vertex* v = outgoing_begin(g, u); v != outgoing_end(g, u); v++) {
+                if (!visited[*v]) {
+                    visited[*v] = 1;
+                    order[tail++] = *v;
+                }
+            }
+            for (const Vertex* v = incoming_begin(g, u); v != incoming_end(g, u); v++) {
+                if (!visited[*v]) {
+                    visited[*v] = 1;
+                    order[tail++] = *v;
+                }
+            }
+
+            std::stable_sort(order + first, order + tail, [g](Vertex a, Vertex b) {
+                return total_degree(g, a) < total_degree(g, b);
+            });
+        }
+    }
+
+    std::reverse(order, order + n);
+}
+
+// Max-priority queue of vertices whose keys only ever change by one
+// (the "unit heap" of the Gorder paper).  Every key has a doubly linked
+// bucket, so increments, decrements and removals are O(1) and pop() only
+// walks down from the highest key seen.
+struct unit_heap
+{
+    std::vector<int> key;
+    std::vector<Vertex> prev;
+    std::vector<Vertex> next;
+    std::vector<Vertex> head;
+    std::vector<char> removed;
+    int top;
+
+    explicit unit_heap(int n)
+        : key(n, 0), prev(n), next(n), head(1, -1), removed(n, 0), top(0)
+    {
+        // link in reverse so ties pop in increasing id order
+        for (Vertex v = n - 1; v >= 0; v--)
+            link(v);
+    }
+
+    void link(Vertex v)
+    {
+        int k = key[v];
+        if (k >= (int) head.size())
+            head.resize(k + 1, -1);
+        prev[v] = -1;
+        next[v] = head[k];
+        if (head[k] >= 0)
+            prev[head[k]] = v;
+        head[k] = v;
+        top = std::max(top, k);
+    }
+
+    void unlink(Vertex v)
+    {
+        if (prev[v] >= 0)
+            next[prev[v]] = next[v];
+        else
+            head[key[v]] = next[v];
+        if (next[v] >= 0)
+            prev[next[v]] = prev[v];
+    }
+
+    void adjust(Vertex v, int delta)
+    {
+        if (removed[v])
+            return;
+        unlink(v);
+        key[v] += delta;
+        link(v);
+    }
+
+    void remove(Vertex v)
+    {
+        unlink(v);
+        removed[v] = 1;
+    }
+
+    Vertex pop()
+    {
+        while (head[top] < 0)
+            top--;
+        Vertex v = head[top];
+        remove(v);
+        return v;
+    }
+};
+
+// Adds delta to the score of every vertex related to v: its in- and
+// out-neighbors, and its siblings (vertices sharing an in-neighbor with
+// it).  Siblings through in-neighbors of degree above hub_degree are
+// skipped, as in Gorder; a hub relates so many vertices that its
+// updates would dominate the run and say little about locality.
+static void gorder_update(const Graph g, unit_heap& heap, Vertex v, int delta, int hub_degree)
+{
+    for (const Vertex* u = outgoing_begin(g, v); u != outgoing_end(g, v); u++)
+        heap.adjust(*u, delta);
+
+    for (const Vertex* x = incoming_begin(g, v); x != incoming_end(g, v); x++) {
+        heap.adjust(*x, delta);
+        if (outgoing_size(g, *x) > hub_degree)
+            continue;
+        for (const Vertex* u = outgoing_begin(g, *x); u != outgoing_end(g, *x); u++)
+            if (*u != v)
+                heap.adjust(*u, delta);
+    }
+}
+
+static void gorder_order(const Graph g, Vertex* order)
+{
+    int n = num_nodes(g);
+    if (n == 0)
+        return;
+
+    int hub_degree = std::max(GORDER_WINDOW, (int) std::sqrt((double) n));
+    unit_heap heap(n);
+
+    // start from the vertex with the largest in-degree
+    Vertex start = 0;
+    for (Vertex v = 1; v < n; v++)
+        if (incoming_size(g, v) > incoming_size(g, start))
+            start = v;
+
+    heap.remove(start);
+    order[0] = start;
+    gorder_update(g, heap, start, 1, hub_degree);
+
+    for (int i = 1; i < n; i++) {
+        if (i > GORDER_WINDOW)
+            gorder_update(g, heap, order[i - GORDER_WINDOW - 1], -1, hub_degree);
+        Vertex v = heap.pop();
+        order[i] = v;
+        gorder_update(g, heap, v, 1, hub_degree);
+    }
+}
+
+Vertex* reorder_permutation(const Graph g, reorder_method method)
+{
+    int n = num_nodes(g);
+    Vertex* order = (Vertex*)malloc(sizeof(Vertex) * std::max(n, 1));
+
+    switch (method) {
+    case REORDER_DEGREE: degree_order(g, order); break;
+    case REORDER_HUB:    hub_order(g, order);    break;
+    case REORDER_RCM:    rcm_order(g, order);    break;
+    case REORDER_GORDER: gorder_order(g, order); break;
+    default:
+        fprintf(stderr, "Unknown reorder method %d.\n", (int) method);
+        exit(1);
+    }
+
+    Vertex* new_id = invert_order(order, n);
+    free(order);
+    return new_id;
+}
+
+// Relabels one side of the CSR.  starts/edges receive the lists of
+// the relabeled graph; list_begin/list_end read the original one.
+template <typename Begin, typename End>
+static void permute_lists(const Graph g, const Vertex* old_id, const Vertex* new_id,
+                          EdgeIndex* starts, Vertex* edges, Begin list_begin, End list_end)
+{
+    int n = num_nodes(g);
+
+    EdgeIndex running = 0;
+    for (int v = 0; v < n; v++) {
+        starts[v] = running;
+        Vertex old = old_id[v];
+        running += list_end(g, old) - list_begin(g, old);
+    }
+
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (int v = 0; v < n; v++) {
+        Vertex old = old_id[v];
+        Vertex* out = edges + starts[v];
+        Vertex* end = out;
+        for (const Vertex* u = list_begin(g, old); u != list_end(g, old); u++)
+            *end++ = new_id[*u];
+        std::sort(out, end);
+    }
+}
+
+// Fills in p's outgoing weights once permute_lists() has sorted its
+// out-lists.  Every list is re-sorted as (neighbor, weight) pairs, so
+// parallel edges keep their weights in a deterministic order.
+static void permute_weights(const Graph g, const Vertex* old_id, const Vertex* new_id, graph* p)
+{
+    int n = num_nodes(g);
+    p->outgoing_weights = (Weight*)malloc(sizeof(Weight) * std::max<EdgeIndex>(num_edges(g), 1));
+
+    #pragma omp parallel
+    {
+        std::vector<std::pair<Vertex, Weight>> list;
+
+        #pragma omp for schedule(dynamic, 1024)
+        for (int v = 0; v < n; v++) {
+            Vertex old = old_id[v];
+            const Weight* w = outgoing_weights_begin(g, old);
+            list.clear();
+            for (const Vertex* u = outgoing_begin(g, old); u != outgoing_end(g, old); u++, w++)
+                list.push_back(std::make_pair(new_id[*u], *w));
+            std::sort(list.begin(), list.end());
+
+            Weight* out = p->outgoing_weights + p->outgoing_starts[v];
+            for (size_t i = 0; i < list.size(); i++)
+                out[i] = list[i].second;
+        }
+    }
+}
+
+Graph permute_graph(const Graph g, const Vertex* new_id)
+{
+    int n = num_nodes(g);
+    EdgeIndex m = num_edges(g);
+
+    graph* p = (graph*)calloc(1, sizeof(graph));
+    p->num_nodes = n;
+    p->num_edges = m;
+    p->outgoing_starts = (EdgeIndex*)malloc(sizeof(EdgeIndex) * n);
+    p->outgoing_edges = (Vertex*)malloc(sizeof(Vertex) * m);
+    p->incoming_starts = (EdgeIndex*)malloc(sizeof(EdgeIndex) * n);
+    p->incoming_edges = (Vertex*)malloc(sizeof(Vertex) * m);
+
+    Vertex* old_id = (Vertex*)malloc(sizeof(Vertex) * std::max(n, 1));
+    #pragma omp parallel for
+    for (int v = 0; v < n; v++)
+        old_id[new_id[v]] = v;
+
+    permute_lists(g, old_id, new_id, p->outgoing_starts, p->outgoing_edges,
+        [](const Graph g, Vertex v) { return outgoing_begin(g, v); },
+        [](const Graph g, Vertex v) { return outgoing_end(g, v); });
+    permute_lists(g, old_id, new_id, p->incoming_starts, p->incoming_edges,
+        [](const Graph g, Vertex v) { return incoming_begin(g, v); },
+        [](const Graph g, Vertex v) { return incoming_end(g, v); });
+
+    if (g->outgoing_weights)
+        permute_weights(g, old_id, new_id, p);
+
+    free(old_id);
+    return p;
+}
@@ -0,0 +1,34 @@
+#ifndef __GRAPH_REORDER_H__
+#define __GRAPH_REORDER_H__
+
+#include "graph.h"
+
+// Vertex relabelings that improve locality of the CSR traversals.  A
+// permutation is an array new_id[] of num_nodes entries: vertex v of
+// the input graph becomes vertex new_id[v] of the relabeled graph.  A
+// per-vertex result computed on the relabeled graph maps back to the
+// original ids as result[v] = relabeled_result[new_id[v]].
+enum reorder_method
+{
+    // descending total (in + out) degree, ties kept in id order
+    REORDER_DEGREE,
+    // vertices of above-average degree first, each group in id order
+    REORDER_HUB,
+    // reverse Cuthill-McKee on the undirected view of the graph
+    REORDER_RCM,
+    // greedy Gorder: places next the vertex sharing the most edges and
+    // in-neighbors with the last GORDER_WINDOW placed vertices
+    REORDER_GORDER,
+};
+
+#define GORDER_WINDOW 5
+
+// Returns a malloc'd new_id[] array for g.
+Vertex* reorder_permutation(const Graph g, reorder_method method);
+
+// Returns a heap-allocated copy of g relabeled by new_id[].  Both
+// neighbor lists of every vertex come out sorted, and outgoing weights
+// move with their edges.
+Graph permute_graph(const Graph g, const Vertex* new_id);
+
+#endif
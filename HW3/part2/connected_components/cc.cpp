@@ -0,0 +1,180 @@
+#include "cc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <omp.h>
+#include <algorithm>
+#include <random>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+#include "../common/graph.h"
+
+// Out-neighbors per vertex linked before the largest component is
+// guessed, and vertices sampled to guess it (see cc_afforest).
+#define AFFOREST_NEIGHBOR_ROUNDS 2
+#define AFFOREST_SAMPLES 1024
+
+void cc_serial(Graph graph, int *components)
+{
+    int n = num_nodes(graph);
+    vector<Vertex> queue(max(n, 1));
+
+    for (int i = 0; i < n; i++)
+        components[i] = -1;
+
+    for (int root = 0; root < n; root++)
+    {
+        if (components[root] != -1)
+            continue;
+
+        components[root] = root;
+        int head = 0, tail = 0;
+        queue[tail++] = root;
+        while (head < tail)
+        {
+            Vertex u = queue[head++];
+            for (const Vertex *v = outgoing_begin(graph, u); v != outgoing_end(graph, u); v++)
+                if (components[*v] == -1)
+                {
+                    components[*v] = root;
+                    queue[tail++] = *v;
+                }
+            for (const Vertex *v = incoming_begin(graph, u); v != incoming_end(graph, u); v++)
+                if (components[*v] == -1)
+                {
+                    components[*v] = root;
+                    queue[tail++] = *v;
+                }
+        }
+    }
+}
+
+// Points every vertex straight at the root of its label tree.  Labels
+// only ever move to smaller ids, so every root is the smallest id of its
+// tree.
+static void compress(int n, int *components)
+{
+    #pragma omp parallel for schedule(dynamic, 16384)
+    for (int i = 0; i < n; i++)
+        while (components[i] != components[components[i]])
+            components[i] = components[components[i]];
+}
+
+void cc_shiloach_vishkin(Graph graph, int *components)
+{
+    int n = num_nodes(graph);
+
+    #pragma omp parallel for
+    for (int i = 0; i < n; i++)
+        components[i] = i;
+
+    bool change = true;
+    while (change)
+    {
+        change = false;
+
+        // concurrent hooks of one root all store smaller ids, so losing
+        // a race only delays a merge to the next round
+        #pragma omp parallel for schedule(dynamic, 16384) reduction(|| : change)
+        for (int u = 0; u < n; u++)
+        {
+            for (const Vertex *v = outgoing_begin(graph, u); v != outgoing_end(graph, u); v++)
+            {
+                int comp_u = components[u];
+                int comp_v = components[*v];
+                if (comp_u == comp_v)
+                    continue;
+                int high = max(comp_u, comp_v);
+                int low = min(comp_u, comp_v);
+                if (components[high] == high)
+                {
+                    change = true;
+                    components[high] = low;
+                }
+            }
+        }
+
+        compress(n, components);
+    }
+}
+
+// Merges the trees of u and v by hooking the larger root onto the
+// smaller label with a compare-and-swap, retrying from the new roots if
+// another thread hooked first.
+static inline void link(Vertex u, Vertex v, int *components)
+{
+    int p1 = components[u];
+    int p2 = components[v];
+    while (p1 != p2)
+    {
+        int high = max(p1, p2);
+        int low = min(p1, p2);
+        int p_high = components[high];
+        if (p_high == low ||
+            (p_high == high && __sync_bool_compare_and_swap(&components[high], high, low)))
+            break;
+        p1 = components[components[high]];
+        p2 = components[low];
+    }
+}
+
+// Most frequent label among a fixed-seed sample of vertices.
+static int sample_frequent_label(int n, const int *components)
+{
+    unordered_map<int, int> counts;
+    mt19937 rng(27491095);
+    uniform_int_distribution<int> pick(0, n - 1);
+    for (int i = 0; i < AFFOREST_SAMPLES; i++)
+        counts[components[pick(rng)]]++;
+
+    int best = components[0], best_count = 0;
+    for (auto &entry : counts)
+        if (entry.second > best_count)
+        {
+            best = entry.first;
+            best_count = entry.second;
+        }
+    return best;
+}
+
+void cc_afforest(Graph graph, int *components)
+{
+    int n = num_nodes(graph);
+    if (n == 0)
+        return;
+
+    #pragma omp parallel for
+    for (int i = 0; i < n; i++)
+        components[i] = i;
+
+    // link the r-th out-neighbor of every vertex; on skewed graphs a
+    // couple of rounds already join most of the giant component
+    for (int r = 0; r < AFFOREST_NEIGHBOR_ROUNDS; r++)
+    {
+        #pragma omp parallel for schedule(dynamic, 16384)
+        for (int u = 0; u < n; u++)
+            if (r < outgoing_size(graph, u))
+                link(u, outgoing_begin(graph, u)[r], components);
+        compress(n, components);
+    }
+
+    int c = sample_frequent_label(n, components);
+
+    // every edge with an endpoint outside c is linked from that
+    // endpoint: its remaining out-edges and, since the sampled edges
+    // were out-edges, all of its in-edges
+    #pragma omp parallel for schedule(dynamic, 16384)
+    for (int u = 0; u < n; u++)
+    {
+        if (components[u] == c)
+            continue;
+        const Vertex *begin = outgoing_begin(graph, u) + min(AFFOREST_NEIGHBOR_ROUNDS, outgoing_size(graph, u));
+        for (const Vertex *v = begin; v != outgoing_end(graph, u); v++)
+            link(u, *v, components);
+        for (const Vertex *v = incoming_begin(graph, u); v != incoming_end(graph, u); v++)
+            link(u, *v, components);
+    }
+
+    compress(n, components);
+}
@@ -0,0 +1,24 @@
+#ifndef __CC_H__
+#define __CC_H__
+
+#include "common/graph.h"
+
+// Weakly connected components: edges are followed in both directions.
+// Every variant labels each vertex with the smallest vertex id of its
+// component, so their results compare equal entry by entry.
+
+// Serial BFS from every unlabeled vertex in id order; the baseline the
+// parallel kernels are checked against.
+void cc_serial(Graph graph, int* components);
+
+// Shiloach-Vishkin style label propagation: every round hooks the root
+// of the larger label of each edge onto the smaller one, then
+// compresses all labels to their roots, until a round hooks nothing.
+void cc_shiloach_vishkin(Graph graph, int* components);
+
+// Afforest: links a few sampled out-neighbors per vertex, guesses the
+// largest component from a vertex sample, and then links the remaining
+// edges of the vertices outside it only.
+void cc_afforest(Graph graph, int* components);
+
+#endif
@@ -0,0 +1,149 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <omp.h>
+#include <string>
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "common/CycleTimer.h"
+#include "common/graph.h"
+#include "cc.h"
+
+// Checks components against the serial labeling; every variant labels
+// a component by its smallest vertex id.
+static bool check_components(Graph g, const int* components, const int* expected, const char* name)
+{
+    std::cout << "Testing Correctness of " << name << "\n";
+    for (int j=0; j<g->num_nodes; j++) {
+        if (components[j] != expected[j]) {
+            fprintf(stderr, "*** Results disagree at %d: %d, %d\n", j, components[j], expected[j]);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+
+    if (argc < 2)
+    {
+        std::cerr << "Usage: <path/to/graph/file> [num_threads]\n";
+        std::cerr << "  To run results for all thread counts: <path/to/graph/file>\n";
+        std::cerr << "  Run with a certain number of threads: <path/to/graph/file> <num_threads>\n";
+        exit(1);
+    }
+
+    int thread_count = -1;
+    if (argc == 3)
+    {
+        thread_count = atoi(argv[2]);
+    }
+
+    printf("----------------------------------------------------------\n");
+    printf("Max system threads = %d\n", omp_get_max_threads());
+    if (thread_count > 0)
+    {
+        thread_count = std::min(thread_count, omp_get_max_threads());
+        printf("Running with %d threads\n", thread_count);
+    }
+    printf("----------------------------------------------------------\n");
+
+    printf("Loading graph...\n");
+    Graph g = load_graph_mmap(argv[1]);
+    printf("\n");
+    printf("Graph stats:\n");
+    printf("  Edges: %lld\n", (long long) g->num_edges);
+    printf("  Nodes: %d\n", g->num_nodes);
+
+    std::vector<int> num_threads;
+    if (thread_count <= -1)
+    {
+        int max_threads = omp_get_max_threads();
+        for (int i = 1; i < max_threads; i *= 2) {
+          num_threads.push_back(i);
+        }
+        num_threads.push_back(max_threads);
+    }
+    else
+    {
+        num_threads.push_back(thread_count);
+    }
+    int n_usage = num_threads.size();
+
+    int* expected = (int*)malloc(sizeof(int) * g->num_nodes);
+    int* components = (int*)malloc(sizeof(int) * g->num_nodes);
+
+    double start = CycleTimer::currentSeconds();
+    cc_serial(g, expected);
+    double serial_time = CycleTimer::currentSeconds() - start;
+
+    int num_components = 0;
+    for (int j=0; j<g->num_nodes; j++)
+        if (expected[j] == j)
+            num_components++;
+    printf("  Components: %d\n", num_components);
+
+    double sv_base = 0, afforest_base = 0;
+    double sv_time, afforest_time;
+    bool sv_check = true, afforest_check = true;
+
+    std::stringstream timing;
+    std::stringstream relative_timing;
+
+    timing          << "Threads  Shiloach-Vishkin  Afforest\n";
+    relative_timing << "Threads  Shiloach-Vishkin  Afforest\n";
+
+    for (int i = 0; i < n_usage; i++)
+    {
+        printf("----------------------------------------------------------\n");
+        std::cout << "Running with " << num_threads[i] << " threads" << std::endl;
+        omp_set_num_threads(num_threads[i]);
+
+        start = CycleTimer::currentSeconds();
+        cc_shiloach_vishkin(g, components);
+        sv_time = CycleTimer::currentSeconds() - start;
+        sv_check &= check_components(g, components, expected, "Shiloach-Vishkin");
+
+        start = CycleTimer::currentSeconds();
+        cc_afforest(g, components);
+        afforest_time = CycleTimer::currentSeconds() - start;
+        afforest_check &= check_components(g, components, expected, "Afforest");
+
+        if (i == 0)
+        {
+            sv_base = sv_time;
+            afforest_base = afforest_time;
+        }
+
+        char buf[1024];
+        char relative_buf[1024];
+
+        sprintf(buf, "%4d:    %.2f (%.2fx)       %.2f (%.2fx)\n",
+                num_threads[i], sv_time, sv_base/sv_time, afforest_time, afforest_base/afforest_time);
+        sprintf(relative_buf, "%4d:   %14.2f     %8.2f\n",
+                num_threads[i], serial_time/sv_time, serial_time/afforest_time);
+
+        timing << buf;
+        relative_timing << relative_buf;
+    }
+
+    printf("----------------------------------------------------------\n");
+    std::cout << "Timing Summary" << std::endl;
+    std::cout << timing.str();
+    printf("----------------------------------------------------------\n");
+    std::cout << "Correctness: " << std::endl;
+    if (!sv_check)
+        std::cout << "Shiloach-Vishkin is not Correct" << std::endl;
+    if (!afforest_check)
+        std::cout << "Afforest is not Correct" << std::endl;
+    printf("Serial BFS baseline: %.2f\n", serial_time);
+    std::cout << std::endl << "Speedup vs. Serial: " << std::endl << relative_timing.str();
+
+    free(components);
+    free(expected);
+    free_graph(g);
+
+    return 0;
+}
@@ -0,0 +1,120 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <omp.h>
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include "common/CycleTimer.h"
+#include "common/graph.h"
+#include "common/grade.h"
+
+#include "page_rank.h"
+
+#define PageRankDampening 0.3f
+#define PageRankConvergence 1e-7d
+
+// Compares the PageRank kernels on one binary graph: the fused pull
+// sweep (pageRank), the cache-blocked sweep (pageRankSegmented) and the
+// residual push/pull engine (pageRankPushPull).  Times are the best of
+// num_runs.  Segmented runs on prebuilt segments; building them is timed
+// on its own.
+//
+// Usage: pr_bench <path/to/graph/file> [num_threads] [num_runs]
+
+typedef void (*page_rank_fn)(Graph, double*, double, double);
+
+static double best_time(page_rank_fn fn, Graph g, double* solution, int num_runs)
+{
+    double best = std::numeric_limits<double>::max();
+    for (int r = 0; r < num_runs; r++) {
+        double start = CycleTimer::currentSeconds();
+        fn(g, solution, PageRankDampening, PageRankConvergence);
+        best = std::min(best, CycleTimer::currentSeconds() - start);
+    }
+    return best;
+}
+
+static void pageRankPushPullCSR(Graph g, double* solution, double damping, double convergence)
+{
+    pageRankPushPull(g, solution, damping, convergence);
+}
+
+static pr_segments segments;
+
+static void pageRankPrebuilt(Graph g, double* solution, double damping, double convergence)
+{
+    pageRankSegmented(g, &segments, solution, damping, convergence);
+}
+
+static void pageRankCSR(Graph g, double* solution, double damping, double convergence)
+{
+    pageRank(g, solution, damping, convergence);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <path/to/graph/file> [num_threads] [num_runs]\n", argv[0]);
+        exit(1);
+    }
+
+    int thread_count = (argc > 2) ? atoi(argv[2]) : -1;
+    int num_runs = (argc > 3) ? atoi(argv[3]) : 3;
+
+    Graph g = load_graph_mmap(argv[1]);
+    printf("Graph stats:\n");
+    printf("  Edges: %lld\n", (long long) g->num_edges);
+    printf("  Nodes: %d\n", g->num_nodes);
+
+    std::vector<int> num_threads;
+    if (thread_count > 0) {
+        num_threads.push_back(thread_count);
+    } else {
+        int max_threads = omp_get_max_threads();
+        for (int i = 1; i < max_threads; i *= 2)
+            num_threads.push_back(i);
+        num_threads.push_back(max_threads);
+    }
+
+    double* base = (double*)malloc(sizeof(double) * g->num_nodes);
+    double* sol = (double*)malloc(sizeof(double) * g->num_nodes);
+    bool correct = true;
+
+    printf("----------------------------------------------------------\n");
+    printf("Threads     pageRank       Build    Segmented (Speedup)    PushPull (Speedup)\n");
+
+    for (size_t i = 0; i < num_threads.size(); i++) {
+        omp_set_num_threads(num_threads[i]);
+
+        double pull_time = best_time(pageRankCSR, g, base, num_runs);
+
+        double start = CycleTimer::currentSeconds();
+        segments = build_pr_segments(g);
+        double build_time = CycleTimer::currentSeconds() - start;
+
+        double segmented_time = best_time(pageRankPrebuilt, g, sol, num_runs);
+        free_pr_segments(&segments);
+        correct &= compareApprox(g, base, sol);
+
+        // push/pull stops on the same L1 rule but not on the same
+        // iterate, so it is checked more loosely
+        double push_pull_time = best_time(pageRankPushPullCSR, g, sol, num_runs);
+        correct &= compareApprox(g, base, sol, RELATIVE_EPSILON_RESIDUAL);
+
+        printf("%4d:     %8.4f    %8.4f     %8.4f (%.2fx)       %8.4f (%.2fx)\n",
+               num_threads[i], pull_time, build_time,
+               segmented_time, pull_time / segmented_time,
+               push_pull_time, pull_time / push_pull_time);
+    }
+
+    printf("----------------------------------------------------------\n");
+    if (!correct)
+        printf("pageRankSegmented or pageRankPushPull does not match pageRank\n");
+
+    free(base);
+    free(sol);
+    free_graph(g);
+    return 0;
+}
@@ -7,6 +7,10 @@
 #include <iostream>
 #include <sstream>
 #include <vector>
+#include <set>
+#include <random>
+#include <algorithm>
+#include <numeric>
 
 #include "common/CycleTimer.h"
 #include "common/graph.h"
@@ -19,8 +23,82 @@
 #define PageRankDampening 0.3f
 #define PageRankConvergence 1e-7d
 
+// Edges removed and inserted for the incremental Page Rank check
+#define IncrementalChanges 32
+
+// Teleport vectors run together in the personalized Page Rank check
+#define PersonalizedSeeds 8
+
+#ifdef GRAPH_64BIT_EDGES
+// ref_pr.a is compiled for 32-bit edge offsets and is not linked into
+// 64-bit builds (see Makefile); the reference run is our own pageRank.
+#define reference_pageRank pageRank
+#else
 void reference_pageRank(Graph g, double* solution, double damping, double convergence);
+#endif
+
+
+// Up to num_changes random edges of g to remove and as many edges g does
+// not have (and no self loops) to insert.
+static void random_delta(Graph g, int num_changes, unsigned seed,
+                         std::vector<edge_change>& inserted, std::vector<edge_change>& removed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> any_vertex(0, g->num_nodes - 1);
+    std::set<std::pair<Vertex, Vertex>> picked;
+
+    for (int tries = 0; (int) removed.size() < num_changes && tries < 100 * num_changes; tries++) {
+        Vertex u = any_vertex(rng);
+        int degree = outgoing_size(g, u);
+        if (degree == 0)
+            continue;
+        Vertex v = outgoing_begin(g, u)[rng() % degree];
+        if (picked.insert(std::make_pair(u, v)).second)
+            removed.push_back({u, v});
+    }
 
+    for (int tries = 0; (int) inserted.size() < num_changes && tries < 100 * num_changes; tries++) {
+        Vertex u = any_vertex(rng);
+        Vertex v = any_vertex(rng);
+        if (u == v || std::find(outgoing_begin(g, u), outgoing_end(g, u), v) != outgoing_end(g, u))
+            continue;
+        if (picked.insert(std::make_pair(u, v)).second)
+            inserted.push_back({u, v});
+    }
+}
+
+// A heap copy of g with the edges of delta removed and inserted
+static Graph apply_delta(Graph g, const graph_delta* delta)
+{
+    std::set<std::pair<Vertex, Vertex>> removed;
+    for (int i = 0; i < delta->num_removed; i++)
+        removed.insert(std::make_pair(delta->removed[i].src, delta->removed[i].dst));
+
+    std::vector<std::pair<Vertex, Vertex>> inserted;
+    for (int i = 0; i < delta->num_inserted; i++)
+        inserted.push_back(std::make_pair(delta->inserted[i].src, delta->inserted[i].dst));
+    std::sort(inserted.begin(), inserted.end());
+
+    graph* edited = (graph*)calloc(1, sizeof(graph));
+    edited->num_nodes = g->num_nodes;
+    edited->num_edges = g->num_edges - delta->num_removed + delta->num_inserted;
+    edited->outgoing_starts = (EdgeIndex*)malloc(sizeof(EdgeIndex) * g->num_nodes);
+    edited->outgoing_edges = (Vertex*)malloc(sizeof(Vertex) * edited->num_edges);
+
+    EdgeIndex at = 0;
+    size_t next = 0;
+    for (int u = 0; u < g->num_nodes; u++) {
+        edited->outgoing_starts[u] = at;
+        for (const Vertex* v = outgoing_begin(g, u); v != outgoing_end(g, u); v++)
+            if (!removed.count(std::make_pair(u, *v)))
+                edited->outgoing_edges[at++] = *v;
+        for (; next < inserted.size() && inserted[next].first == u; next++)
+            edited->outgoing_edges[at++] = inserted[next].second;
+    }
+
+    build_incoming_edges(edited);
+    return edited;
+}
 
 int main(int argc, char** argv) {
 
@@ -56,7 +134,7 @@ int main(int argc, char** argv) {
 
     printf("Loading graph...\n");
     if (USE_BINARY_GRAPH) {
-      g = load_graph_binary(graph_filename.c_str());
+      g = load_graph_mmap(graph_filename.c_str());
     } else {
         g = load_graph(argv[1]);
         printf("storing binary form of graph!\n");
@@ -66,7 +144,7 @@ int main(int argc, char** argv) {
     }
     printf("\n");
     printf("Graph stats:\n");
-    printf("  Edges: %d\n", g->num_edges);
+    printf("  Edges: %lld\n", (long long) g->num_edges);
     printf("  Nodes: %d\n", g->num_nodes);
 
     //If we want to run on all threads
@@ -84,6 +162,49 @@ int main(int argc, char** argv) {
         num_threads.push_back(max_threads);
         int n_usage = num_threads.size();
 
+        // the compressed kernels are checked on the same graph
+        CompressedGraph cg = compress_graph(g);
+        printf("  Compressed: %.2f MB\n", compressed_graph_bytes(cg) / (1024.0 * 1024.0));
+
+        // a warm start from the scores of g plus a small batch of edge
+        // changes must reach the scores of the edited graph
+        std::vector<edge_change> inserted_edges, removed_edges;
+        random_delta(g, IncrementalChanges, 15213, inserted_edges, removed_edges);
+        graph_delta delta = {(int) inserted_edges.size(), inserted_edges.data(),
+                             (int) removed_edges.size(), removed_edges.data()};
+        Graph edited = apply_delta(g, &delta);
+        printf("  Incremental: %d inserted, %d removed edges\n",
+               delta.num_inserted, delta.num_removed);
+
+        double* prior;
+        prior = (double*)malloc(sizeof(double) * g->num_nodes);
+        pageRank(g, prior, PageRankDampening, PageRankConvergence);
+
+        double* edited_expected;
+        edited_expected = (double*)malloc(sizeof(double) * g->num_nodes);
+        double* sol_incremental;
+        sol_incremental = (double*)malloc(sizeof(double) * g->num_nodes);
+
+        // personalized Page Rank with one teleport vector over all
+        // vertices is Page Rank.  With PersonalizedSeeds small weighted
+        // seeds, each seed's scores must still sum to 1.
+        std::vector<Vertex> all_vertices(g->num_nodes);
+        std::iota(all_vertices.begin(), all_vertices.end(), 0);
+        teleport_vector uniform_teleport = {g->num_nodes, all_vertices.data(), NULL};
+
+        const double seed_weights[2] = {1.0, 3.0};
+        std::vector<Vertex> seed_vertices(2 * PersonalizedSeeds);
+        std::vector<teleport_vector> seeds(PersonalizedSeeds);
+        for (int k = 0; k < PersonalizedSeeds; k++) {
+            Vertex v = (Vertex)((int64_t) k * g->num_nodes / PersonalizedSeeds);
+            seed_vertices[2 * k] = v;
+            seed_vertices[2 * k + 1] = (v + 1) % g->num_nodes;
+            seeds[k] = {2, &seed_vertices[2 * k], seed_weights};
+        }
+
+        double* sol_personalized;
+        sol_personalized = (double*)malloc(sizeof(double) * g->num_nodes * PersonalizedSeeds);
+
         double* sol1;
         sol1 = (double*)malloc(sizeof(double) * g->num_nodes);
         double* sol2;
@@ -95,9 +216,35 @@ int main(int argc, char** argv) {
         double* sol4;
         sol4 = (double*)malloc(sizeof(double) * g->num_nodes);
 
+        //Single-precision scores
+        float* sol_float;
+        sol_float = (float*)malloc(sizeof(float) * g->num_nodes);
+
+        //Push/pull scores
+        double* sol_push;
+        sol_push = (double*)malloc(sizeof(double) * g->num_nodes);
+
         double pagerank_base;
         double pagerank_time;
 
+        double float_base;
+        double float_time;
+
+        double push_base;
+        double push_time;
+
+        double compressed_base;
+        double compressed_time;
+
+        double compressed_push_base;
+        double compressed_push_time;
+
+        double incremental_time;
+        double full_time;
+
+        double uniform_time;
+        double seeds_time;
+
         double ref_pagerank_base;
         double ref_pagerank_time;
 
@@ -105,10 +252,26 @@ int main(int argc, char** argv) {
         std::stringstream timing;
         std::stringstream ref_timing;
         std::stringstream relative_timing;
+        std::stringstream float_timing;
+        std::stringstream push_timing;
+        std::stringstream compressed_timing;
+        std::stringstream incremental_timing;
+        std::stringstream personalized_timing;
 
         bool pr_check = true;
+        bool float_check = true;
+        bool push_check = true;
+        bool compressed_check = true;
+        bool compressed_push_check = true;
+        bool incremental_check = true;
+        bool personalized_check = true;
 
         timing << "Threads  Time (Speedup)\n";
+        float_timing << "Threads  Time (Speedup)\n";
+        push_timing << "Threads  Time (Speedup)\n";
+        compressed_timing << "Threads  Page Rank          Push/Pull\n";
+        incremental_timing << "Threads  Incremental  Full Recompute\n";
+        personalized_timing << "Threads  Uniform      " << PersonalizedSeeds << " Seeds\n";
         ref_timing << "Threads  Time (Speedup)\n";
         relative_timing << "Threads  Speedup\n";
 
@@ -125,6 +288,22 @@ int main(int argc, char** argv) {
             pageRank(g, sol1, PageRankDampening, PageRankConvergence);
             pagerank_time = CycleTimer::currentSeconds() - start;
 
+            start = CycleTimer::currentSeconds();
+            pageRank<float>(g, sol_float, PageRankDampening, PageRankConvergence);
+            float_time = CycleTimer::currentSeconds() - start;
+
+            start = CycleTimer::currentSeconds();
+            pageRankPushPull(g, sol_push, PageRankDampening, PageRankConvergence);
+            push_time = CycleTimer::currentSeconds() - start;
+
+            start = CycleTimer::currentSeconds();
+            pageRank(cg, sol2, PageRankDampening, PageRankConvergence);
+            compressed_time = CycleTimer::currentSeconds() - start;
+
+            start = CycleTimer::currentSeconds();
+            pageRankPushPull(cg, sol3, PageRankDampening, PageRankConvergence);
+            compressed_push_time = CycleTimer::currentSeconds() - start;
+
             //Run staff reference implementation
             start = CycleTimer::currentSeconds();
             reference_pageRank(g, sol4, PageRankDampening, PageRankConvergence);
@@ -134,16 +313,77 @@ int main(int argc, char** argv) {
             if (num_threads[i] == 1) {
                 pagerank_base = pagerank_time;
                 ref_pagerank_base = ref_pagerank_time;
+                float_base = float_time;
+                push_base = push_time;
+                compressed_base = compressed_time;
+                compressed_push_base = compressed_push_time;
             }
 
             std::cout << "Testing Correctness of Page Rank\n";
             if (!compareApprox(g, sol4, sol1)) {
               pr_check = false;
             }
+            if (!compareApprox(g, sol4, sol_float)) {
+              float_check = false;
+            }
+            // stops on the same L1 rule, but on a different iterate
+            if (!compareApprox(g, sol4, sol_push, RELATIVE_EPSILON_RESIDUAL)) {
+              push_check = false;
+            }
+            if (!compareApprox(g, sol4, sol2)) {
+              compressed_check = false;
+            }
+            if (!compareApprox(g, sol4, sol3, RELATIVE_EPSILON_RESIDUAL)) {
+              compressed_push_check = false;
+            }
+
+            start = CycleTimer::currentSeconds();
+            pageRank(edited, edited_expected, PageRankDampening, PageRankConvergence);
+            full_time = CycleTimer::currentSeconds() - start;
+
+            start = CycleTimer::currentSeconds();
+            pageRankIncremental(edited, &delta, prior, sol_incremental,
+                                PageRankDampening, PageRankConvergence);
+            incremental_time = CycleTimer::currentSeconds() - start;
+
+            std::cout << "Testing Correctness of Incremental Page Rank\n";
+            if (!compareApprox(edited, edited_expected, sol_incremental, RELATIVE_EPSILON_RESIDUAL)) {
+              incremental_check = false;
+            }
+
+            start = CycleTimer::currentSeconds();
+            personalizedPageRank(g, &uniform_teleport, 1, sol_personalized,
+                                 PageRankDampening, PageRankConvergence);
+            uniform_time = CycleTimer::currentSeconds() - start;
+
+            std::cout << "Testing Correctness of Personalized Page Rank\n";
+            if (!compareApprox(g, sol4, sol_personalized)) {
+              personalized_check = false;
+            }
+
+            start = CycleTimer::currentSeconds();
+            personalizedPageRank(g, seeds.data(), PersonalizedSeeds, sol_personalized,
+                                 PageRankDampening, PageRankConvergence);
+            seeds_time = CycleTimer::currentSeconds() - start;
+
+            for (int k = 0; k < PersonalizedSeeds; k++) {
+              double total = 0.0;
+              for (int v = 0; v < g->num_nodes; v++)
+                total += sol_personalized[(size_t) v * PersonalizedSeeds + k];
+              if (fabs(total - 1.0) > 1e-6) {
+                std::cerr << "*** Scores of seed " << k << " sum to " << total << std::endl;
+                personalized_check = false;
+              }
+            }
 
             char buf[1024];
             char ref_buf[1024];
             char relative_buf[1024];
+            char float_buf[1024];
+            char push_buf[1024];
+            char compressed_buf[1024];
+            char incremental_buf[1024];
+            char personalized_buf[1024];
 
             sprintf(buf, "%4d:   %.4f (%.4fx)\n",
                     num_threads[i], pagerank_time, pagerank_base/pagerank_time);
@@ -152,10 +392,26 @@ int main(int argc, char** argv) {
                     ref_pagerank_base/ref_pagerank_time);
             sprintf(relative_buf, "%4d:     %.2fx\n",
                     num_threads[i], ref_pagerank_time/pagerank_time);
+            sprintf(float_buf, "%4d:   %.4f (%.4fx)\n",
+                    num_threads[i], float_time, float_base/float_time);
+            sprintf(push_buf, "%4d:   %.4f (%.4fx)\n",
+                    num_threads[i], push_time, push_base/push_time);
+            sprintf(compressed_buf, "%4d:   %.4f (%.4fx)  %.4f (%.4fx)\n",
+                    num_threads[i], compressed_time, compressed_base/compressed_time,
+                    compressed_push_time, compressed_push_base/compressed_push_time);
+            sprintf(incremental_buf, "%4d:   %.4f       %.4f\n",
+                    num_threads[i], incremental_time, full_time);
+            sprintf(personalized_buf, "%4d:   %.4f       %.4f\n",
+                    num_threads[i], uniform_time, seeds_time);
 
             timing << buf;
             ref_timing << ref_buf;
             relative_timing << relative_buf;
+            float_timing << float_buf;
+            push_timing << push_buf;
+            compressed_timing << compressed_buf;
+            incremental_timing << incremental_buf;
+            personalized_timing << personalized_buf;
         }
 
         printf("----------------------------------------------------------\n");
@@ -165,10 +421,44 @@ int main(int argc, char** argv) {
         std::cout << "Reference: Timing Summary" << std::endl;
         std::cout << ref_timing.str();
         printf("----------------------------------------------------------\n");
+        std::cout << "Float Scores: Timing Summary" << std::endl;
+        std::cout << float_timing.str();
+        printf("----------------------------------------------------------\n");
+        std::cout << "Push/Pull: Timing Summary" << std::endl;
+        std::cout << push_timing.str();
+        printf("----------------------------------------------------------\n");
+        std::cout << "Compressed Graph: Timing Summary" << std::endl;
+        std::cout << compressed_timing.str();
+        printf("----------------------------------------------------------\n");
+        std::cout << "Incremental: Timing Summary" << std::endl;
+        std::cout << incremental_timing.str();
+        printf("----------------------------------------------------------\n");
+        std::cout << "Personalized: Timing Summary" << std::endl;
+        std::cout << personalized_timing.str();
+        printf("----------------------------------------------------------\n");
         std::cout << "Correctness: " << std::endl;
         if (!pr_check)
             std::cout << "Page Rank is not Correct" << std::endl;
+        if (!float_check)
+            std::cout << "Float Page Rank is not Correct" << std::endl;
+        if (!push_check)
+            std::cout << "Push/Pull Page Rank is not Correct" << std::endl;
+        if (!compressed_check)
+            std::cout << "Compressed Page Rank is not Correct" << std::endl;
+        if (!compressed_push_check)
+            std::cout << "Compressed Push/Pull Page Rank is not Correct" << std::endl;
+        if (!incremental_check)
+            std::cout << "Incremental Page Rank is not Correct" << std::endl;
+        if (!personalized_check)
+            std::cout << "Personalized Page Rank is not Correct" << std::endl;
         std::cout << std::endl << "Relative Speedup to Reference: " << std::endl <<  relative_timing.str();
+
+        free(prior);
+        free(edited_expected);
+        free(sol_incremental);
+        free(sol_personalized);
+        free_graph(edited);
+        free_compressed_graph(cg);
     }
     //Run the code with only one thread count and only report speedup
     else
@@ -1,85 +1,121 @@
 #include "page_rank.h"
 
+#include <stdio.h>
 #include <stdlib.h>
+#include <unistd.h>
+#include <algorithm>
 #include <cmath>
 #include <omp.h>
 #include <utility>
+#include <vector>
 
 #include "../common/CycleTimer.h"
 #include "../common/graph.h"
 
 // pageRank --
 //
-// g:           graph to process (see common/graph.h)
+// g:           graph to process (see common/graph.h, or
+//              common/compressed_graph.h for the compressed form)
 // solution:    array of per-vertex vertex scores (length of array is num_nodes(g))
 // damping:     page-rank algorithm's damping parameter
 // convergence: page-rank algorithm's convergence threshold
 //
-void pageRank(Graph g, double *solution, double damping, double convergence)
+// Each sweep makes one pass over the vertices.  contrib[v] holds
+// score[v] / outdeg(v) for the current scores (0 for dead ends), so the
+// pull over in-edges is a plain gathered sum, and the same pass stores
+// the new score, its contrib for the next sweep, the dead-end mass and
+// the L1 change.  Scores and contribs ping-pong between two buffers each
+// instead of being copied.
+//
+// T is the storage type of the per-vertex arrays.  Sums over in-edges,
+// the dead-end mass and the L1 change are accumulated in double either
+// way, so float storage halves the bytes streamed per sweep and only
+// rounds each stored value.  compensated makes every thread's share of
+// the L1 change a Kahan sum.
+template <typename T, typename G>
+static void pageRankImpl(G g, T *solution, double damping, double convergence, bool compensated)
 {
 
-  // initialize vertex weights to uniform probability. Double
-  // precision scores are used to avoid underflow for large graphs
+  // initialize vertex weights to uniform probability
 
     int numNodes = num_nodes(g);
     double equal_prob = 1.0 / numNodes;
 
-    #pragma omp parallel for
+    T *invOutDegree = (T *) malloc(numNodes * sizeof(T));
+    T *scoreOther = (T *) malloc(numNodes * sizeof(T));
+    T *contrib = (T *) malloc(numNodes * sizeof(T));
+    T *contribNext = (T *) malloc(numNodes * sizeof(T));
+
+    double deadSum = 0.0;
+    #pragma omp parallel for reduction(+:deadSum)
     for (int i = 0; i < numNodes; ++i)
     {
-        solution[i] = equal_prob;
+        int totalOut = outgoing_size(g, i);
+        invOutDegree[i] = (totalOut > 0) ? (T) (1.0 / totalOut) : (T) 0;
+        solution[i] = (T) equal_prob;
+        contrib[i] = (T) (equal_prob * invOutDegree[i]);
+        if (totalOut == 0)
+            deadSum += (T) equal_prob;
     }
 
-    double *scoreOld = (double *) malloc(numNodes * sizeof(double));
+    T *score = solution;
+    T *scoreNew = scoreOther;
 
     bool converge = false;
 
     while (!converge) 
     {
-        #pragma omp parallel for
-        for (int i = 0; i < numNodes; i++) {
-            scoreOld[i] = solution[i];
-        }
+        double base = (1.0 - damping) / numNodes + damping * deadSum / numNodes;
+        double globDiff = 0.0;
+        double deadSumNew = 0.0;
 
-        #pragma omp parallel for
-        for (int vi = 0; vi < numNodes; vi++) {
-            double incomingScore = 0.0;
+        #pragma omp parallel reduction(+:globDiff, deadSumNew)
+        {
+            double carry = 0.0;
 
-            for (const Vertex *in = incoming_begin(g, vi); in != incoming_end(g, vi); in++) {
-                Vertex vj = *in;
-                int totalOut = outgoing_size(g, vj);
-                if (totalOut > 0) {
-                    incomingScore += scoreOld[vj] / totalOut;
-                }
-            }
-            
-            solution[vi] = (damping * incomingScore) + ((1.0 - damping) / numNodes);
-        }
+            #pragma omp for schedule(dynamic, 1024) nowait
+            for (int vi = 0; vi < numNodes; vi++) {
+                double incomingScore = 0.0;
 
-        double deadSum = 0.0;
-        #pragma omp parallel for reduction(+:deadSum)
-        for (int v = 0; v < numNodes; v++) {
-            if (outgoing_size(g, v) == 0) {
-                deadSum += scoreOld[v];
+                auto end = incoming_end(g, vi);
+                for (auto in = incoming_begin(g, vi); in != end; in++)
+                    incomingScore += contrib[*in];
+
+                T value = (T) ((damping * incomingScore) + base);
+                scoreNew[vi] = value;
+                contribNext[vi] = (T) ((double) value * invOutDegree[vi]);
+                if (invOutDegree[vi] == 0)
+                    deadSumNew += value;
+
+                double change = fabs((double) value - (double) score[vi]);
+                if (compensated) {
+                    double y = change - carry;
+                    double t = globDiff + y;
+                    carry = (t - globDiff) - y;
+                    globDiff = t;
+                } else {
+                    globDiff += change;
+                }
             }
         }
 
-        deadSum = damping * deadSum / numNodes;
-        #pragma omp parallel for
-        for (int vi = 0; vi < numNodes; vi++) 
-            solution[vi] += deadSum;
-        
+        std::swap(score, scoreNew);
+        std::swap(contrib, contribNext);
+        deadSum = deadSumNew;
 
-        double globDiff = 0.0;
-        #pragma omp parallel for reduction(+:globDiff)
-        for (int vi = 0; vi < numNodes; vi++) {
-            globDiff += fabs(solution[vi] - scoreOld[vi]);  
-        }
-        
         converge = globDiff < convergence;
     }
 
-    free(scoreOld);
+    if (score != solution) {
+        #pragma omp parallel for
+        for (int i = 0; i < numNodes; i++)
+            solution[i] = score[i];
+    }
+
+    free(invOutDegree);
+    free(scoreOther);
+    free(contrib);
+    free(contribNext);
   /*
      For PP students: Implement the page rank algorithm here.  You
      are expected to parallelize the algorithm using openMP.  Your
@@ -109,3 +145,804 @@ void pageRank(Graph g, double *solution, double damping, double convergence)
 
    */
 }
+
+void pageRank(Graph g, double *solution, double damping, double convergence)
+{
+    pageRankImpl(g, solution, damping, convergence, false);
+}
+
+void pageRank(CompressedGraph g, double *solution, double damping, double convergence)
+{
+    pageRankImpl(g, solution, damping, convergence, false);
+}
+
+template <typename T>
+void pageRank(Graph g, T *solution, double damping, double convergence, bool compensated)
+{
+    pageRankImpl(g, solution, damping, convergence, compensated);
+}
+
+template void pageRank<float>(Graph, float *, double, double, bool);
+template void pageRank<double>(Graph, double *, double, double, bool);
+
+// Switch from pull sweeps to push rounds once the active vertices plus
+// their out-edges are below 1/PR_PUSH_RATIO of the whole graph.
+#ifndef PR_PUSH_RATIO
+#define PR_PUSH_RATIO 20
+#endif
+
+// Puts the vertices with |r| > threshold on worklist, marks them queued
+// and returns how many there are.
+static int collect_active(const double *r, int numNodes, double threshold, int *worklist, unsigned char *queued)
+{
+    int count = 0;
+    #pragma omp parallel
+    {
+        std::vector<int> local;
+        #pragma omp for nowait
+        for (int v = 0; v < numNodes; v++)
+            if (fabs(r[v]) > threshold)
+                local.push_back(v);
+        int at = __sync_fetch_and_add(&count, (int) local.size());
+        for (size_t i = 0; i < local.size(); i++) {
+            worklist[at + i] = local[i];
+            queued[local[i]] = 1;
+        }
+    }
+    return count;
+}
+
+// Residual PageRank.  Alongside the estimate x every vertex keeps its
+// residual r = b + M x - x, where b is the teleport term and M spreads
+// d * x[u] / outdeg(u) along out-edges (and d * x[u] / n to every vertex
+// if u is a dead end).  Pushing u moves r[u] into x[u] and spreads
+// d * r[u] to its neighbors; the L1 residual drops by at least
+// (1 - d) * |r[u]|.  Iterating until |r|_1 < convergence gives the same
+// stopping point as the pull iteration, where |r|_1 is exactly the
+// change between sweeps.
+//
+// While many vertices are active a pull sweep pushes all of them at
+// once: it gathers the contributions r[u] / outdeg(u) like pageRankImpl
+// and computes the exact L1 residual.  Once few are active, push rounds
+// take only the vertices on a worklist (|r| > convergence / 2n) and add
+// into their out-neighbors' residuals with atomics, queueing neighbors
+// that become active.  Their cost follows the changed region rather than
+// the graph.
+//
+// Mass pushed from dead ends goes to every vertex.  Push rounds keep it
+// apart as a uniform residual U (uniform, passed in by warm starts too):
+// pull sweeps fold it into r, and otherwise it is resolved in closed
+// form at the end.  The teleport term b is uniform, (1 - d) / n, so with
+// s = U n / (1 - d - U n) scaling both x and r by (1 + s) removes U
+// exactly: s b = (1 + s) U.  Push rounds only
+// track an upper bound on |r|_1, and a pull sweep settles it exactly.
+template <typename G>
+static void residualPageRank(G g, double *x, double *residual, double uniform, double damping,
+                             double convergence)
+{
+    int numNodes = num_nodes(g);
+    EdgeIndex numEdges = num_edges(g);
+    double threshold = convergence / (2.0 * numNodes);
+
+    double *invOutDegree = (double *) malloc(numNodes * sizeof(double));
+    double *rBuffer = (double *) malloc(numNodes * sizeof(double));
+    double *contrib = (double *) malloc(numNodes * sizeof(double));
+    unsigned char *queued = (unsigned char *) malloc(numNodes);
+    int *worklist = (int *) malloc(numNodes * sizeof(int));
+    double *pushed = (double *) malloc(numNodes * sizeof(double));
+
+    #pragma omp parallel for
+    for (int v = 0; v < numNodes; v++) {
+        int totalOut = outgoing_size(g, v);
+        invOutDegree[v] = (totalOut > 0) ? 1.0 / totalOut : 0.0;
+        queued[v] = 0;
+    }
+
+    double *r = residual;
+    double *rOther = rBuffer;
+
+    double bound = 0.0;         // upper bound on |r|_1, without uniform
+    int worklistSize = 0;
+
+    // 1 + s for the uniform residual so far
+    auto scale = [&]() {
+        return 1.0 + uniform * numNodes / (1.0 - damping - uniform * numNodes);
+    };
+    // |r|_1 after the final scaling
+    auto settled = [&]() {
+        return bound * fabs(scale()) < convergence;
+    };
+
+    // a warm start may begin with few active vertices: start with push
+    // rounds then
+    EdgeIndex activeWork = 0;
+    #pragma omp parallel for reduction(+:bound, activeWork)
+    for (int v = 0; v < numNodes; v++) {
+        bound += fabs(r[v]);
+        if (fabs(r[v]) > threshold)
+            activeWork += 1 + outgoing_size(g, v);
+    }
+
+    bool pull = activeWork >= ((EdgeIndex) numNodes + numEdges) / PR_PUSH_RATIO;
+    if (!pull)
+        worklistSize = collect_active(r, numNodes, threshold, worklist, queued);
+
+    while (!settled())
+    {
+        if (pull) {
+            // fold uniform into r and set up the contributions
+            double deadSum = 0.0;
+            #pragma omp parallel for reduction(+:deadSum)
+            for (int v = 0; v < numNodes; v++) {
+                double rv = r[v] + uniform;
+                r[v] = rv;
+                contrib[v] = rv * invOutDegree[v];
+                if (invOutDegree[v] == 0.0)
+                    deadSum += rv;
+                queued[v] = 0;
+            }
+            uniform = 0.0;
+
+            double spread = damping * deadSum / numNodes;
+            double norm = 0.0;
+            EdgeIndex activeWork = 0;
+
+            #pragma omp parallel for schedule(dynamic, 1024) reduction(+:norm, activeWork)
+            for (int vi = 0; vi < numNodes; vi++) {
+                double incoming = 0.0;
+
+                auto end = incoming_end(g, vi);
+                for (auto in = incoming_begin(g, vi); in != end; in++)
+                    incoming += contrib[*in];
+
+                double value = damping * incoming + spread;
+                x[vi] += r[vi];
+                rOther[vi] = value;
+                norm += fabs(value);
+                if (fabs(value) > threshold)
+                    activeWork += 1 + outgoing_size(g, vi);
+            }
+
+            std::swap(r, rOther);
+            bound = norm;
+            if (settled())
+                break;
+
+            if (activeWork < ((EdgeIndex) numNodes + numEdges) / PR_PUSH_RATIO) {
+                worklistSize = collect_active(r, numNodes, threshold, worklist, queued);
+                pull = false;
+            }
+            continue;
+        }
+
+        // push round: take the residual of every queued vertex ...
+        double taken = 0.0;
+        #pragma omp parallel for reduction(+:taken)
+        for (int i = 0; i < worklistSize; i++) {
+            int u = worklist[i];
+            double delta = r[u];
+            pushed[i] = delta;
+            x[u] += delta;
+            r[u] = 0.0;
+            queued[u] = 0;
+            taken += fabs(delta);
+        }
+
+        // ... and spread it, queueing neighbors that become active
+        double deadSum = 0.0;
+        int count = 0;
+        EdgeIndex activeWork = 0;
+        int *next = (int *) rOther;   // free during push rounds
+
+        #pragma omp parallel reduction(+:deadSum, activeWork)
+        {
+            std::vector<int> local;
+
+            #pragma omp for schedule(dynamic, 64)
+            for (int i = 0; i < worklistSize; i++) {
+                int u = worklist[i];
+                double delta = pushed[i];
+                double inv = invOutDegree[u];
+
+                if (inv == 0.0) {
+                    deadSum += delta;
+                    continue;
+                }
+
+                double share = damping * delta * inv;
+                auto end = outgoing_end(g, u);
+                for (auto out = outgoing_begin(g, u); out != end; out++) {
+                    Vertex v = *out;
+                    double after;
+                    #pragma omp atomic capture
+                    { r[v] += share; after = r[v]; }
+                    if (fabs(after) > threshold && !queued[v] &&
+                        __sync_bool_compare_and_swap(&queued[v], 0, 1)) {
+                        local.push_back(v);
+                        activeWork += 1 + outgoing_size(g, v);
+                    }
+                }
+            }
+
+            int at = __sync_fetch_and_add(&count, (int) local.size());
+            for (size_t i = 0; i < local.size(); i++)
+                next[at + i] = local[i];
+        }
+
+        #pragma omp parallel for
+        for (int i = 0; i < count; i++)
+            worklist[i] = next[i];
+        worklistSize = count;
+
+        uniform += damping * deadSum / numNodes;
+        bound -= (1.0 - damping) * taken;
+        if (settled())
+            break;
+
+        // an empty worklist with the bound still too high means the
+        // bound is loose: let a pull sweep settle it
+        if (worklistSize == 0 ||
+            activeWork >= ((EdgeIndex) numNodes + numEdges) / PR_PUSH_RATIO)
+            pull = true;
+    }
+
+    // resolve the uniform residual and leave the final residual in the
+    // caller's array
+    double factor = scale();
+    if (factor != 1.0 || r != residual) {
+        #pragma omp parallel for
+        for (int v = 0; v < numNodes; v++) {
+            x[v] *= factor;
+            residual[v] = r[v] * factor;
+        }
+    }
+
+    free(invOutDegree);
+    free(rBuffer);
+    free(contrib);
+    free(queued);
+    free(worklist);
+    free(pushed);
+}
+
+// Starts from uniform scores like pageRankImpl and computes their
+// residual with one sweep, then hands over to residualPageRank.
+template <typename G>
+static void pageRankPushPullImpl(G g, double *solution, double damping, double convergence)
+{
+    int numNodes = num_nodes(g);
+    double equal_prob = 1.0 / numNodes;
+
+    double *residual = (double *) malloc(numNodes * sizeof(double));
+    double *contrib = (double *) malloc(numNodes * sizeof(double));
+
+    double deadSum = 0.0;
+    #pragma omp parallel for reduction(+:deadSum)
+    for (int v = 0; v < numNodes; v++) {
+        int totalOut = outgoing_size(g, v);
+        solution[v] = equal_prob;
+        contrib[v] = (totalOut > 0) ? equal_prob / totalOut : 0.0;
+        if (totalOut == 0)
+            deadSum += equal_prob;
+    }
+
+    double base = (1.0 - damping) / numNodes + damping * deadSum / numNodes;
+
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (int vi = 0; vi < numNodes; vi++) {
+        double incoming = 0.0;
+
+        auto end = incoming_end(g, vi);
+        for (auto in = incoming_begin(g, vi); in != end; in++)
+            incoming += contrib[*in];
+
+        residual[vi] = damping * incoming + base - solution[vi];
+    }
+
+    free(contrib);
+
+    residualPageRank(g, solution, residual, 0.0, damping, convergence);
+
+    free(residual);
+}
+
+void pageRankPushPull(Graph g, double *solution, double damping, double convergence)
+{
+    pageRankPushPullImpl(g, solution, damping, convergence);
+}
+
+void pageRankPushPull(CompressedGraph g, double *solution, double damping, double convergence)
+{
+    pageRankPushPullImpl(g, solution, damping, convergence);
+}
+
+
+// Segmented (cache-blocked) pull.  The gather in pageRankImpl reads
+// contrib[u] at random over all sources; once that array outgrows the
+// cache most reads miss.  Here the sources are split into segments of
+// segment_vertices() vertices and the in-edges of every vertex are
+// grouped by the segment of their source, so a pass over one segment's
+// edges only touches that slice of contrib.  Per-vertex sums from each
+// segment accumulate in acc; the fused update pass of pageRankImpl then
+// finishes the sweep.
+
+// Sources per segment: enough contributions to fill half of one core's
+// L2 unless PR_SEGMENT_BYTES says otherwise.
+static int segment_vertices()
+{
+#ifdef PR_SEGMENT_BYTES
+    long bytes = PR_SEGMENT_BYTES;
+#else
+    long bytes = sysconf(_SC_LEVEL2_CACHE_SIZE) / 2;
+    if (bytes <= 0)
+        bytes = 256 * 1024;
+#endif
+    return (int) std::max<long>(1024, bytes / sizeof(double));
+}
+
+// Visits the in-list of v segment by segment, calling emit(segment,
+// begin, end) for each run of sources in the same segment.  Lists that
+// are not sorted are sorted into scratch first.
+template <typename Emit>
+static void for_each_segment_run(Graph g, Vertex v, int segment_size, std::vector<Vertex> &scratch, Emit emit)
+{
+    const Vertex *begin = incoming_begin(g, v);
+    const Vertex *end = incoming_end(g, v);
+    if (!std::is_sorted(begin, end)) {
+        scratch.assign(begin, end);
+        std::sort(scratch.begin(), scratch.end());
+        begin = scratch.data();
+        end = begin + scratch.size();
+    }
+
+    while (begin != end) {
+        int segment = *begin / segment_size;
+        Vertex limit = (Vertex) std::min<int64_t>((int64_t) (segment + 1) * segment_size, num_nodes(g));
+        const Vertex *run = begin;
+        while (run != end && *run < limit)
+            run++;
+        emit(segment, begin, run);
+        begin = run;
+    }
+}
+
+// Builds the segments in two passes over the in-lists.  Each block of
+// vertices counts its slots and edges per segment, a segment-major scan
+// of the counts gives every (segment, block) pair its output range, and
+// the second pass fills them.
+pr_segments build_pr_segments(Graph g)
+{
+    pr_segments seg;
+    int n = num_nodes(g);
+    seg.segment_size = segment_vertices();
+    seg.num_segments = std::max(1, (n + seg.segment_size - 1) / seg.segment_size);
+
+    int S = seg.num_segments;
+    int B = omp_get_max_threads();
+    int64_t *slot_counts = (int64_t *) calloc((size_t) B * S + 1, sizeof(int64_t));
+    int64_t *edge_counts = (int64_t *) calloc((size_t) B * S + 1, sizeof(int64_t));
+
+    #pragma omp parallel for schedule(static, 1)
+    for (int b = 0; b < B; b++) {
+        std::vector<Vertex> scratch;
+        int begin = (int) ((int64_t) n * b / B);
+        int end = (int) ((int64_t) n * (b + 1) / B);
+        for (int v = begin; v < end; v++)
+            for_each_segment_run(g, v, seg.segment_size, scratch,
+                [&](int s, const Vertex *first, const Vertex *last) {
+                    slot_counts[(size_t) s * B + b]++;
+                    edge_counts[(size_t) s * B + b] += last - first;
+                });
+    }
+
+    // exclusive scans, segment-major then block
+    int64_t slots = 0, edges = 0;
+    for (size_t i = 0; i < (size_t) B * S; i++) {
+        int64_t c = slot_counts[i];
+        slot_counts[i] = slots;
+        slots += c;
+        c = edge_counts[i];
+        edge_counts[i] = edges;
+        edges += c;
+    }
+
+    seg.dest_starts = (int64_t *) malloc(sizeof(int64_t) * (S + 1));
+    for (int s = 0; s < S; s++)
+        seg.dest_starts[s] = slot_counts[(size_t) s * B];
+    seg.dest_starts[S] = slots;
+
+    seg.dests = (Vertex *) malloc(sizeof(Vertex) * std::max<int64_t>(slots, 1));
+    seg.edge_starts = (int64_t *) malloc(sizeof(int64_t) * (slots + 1));
+    seg.sources = (Vertex *) malloc(sizeof(Vertex) * std::max<int64_t>(edges, 1));
+    seg.edge_starts[slots] = edges;
+
+    #pragma omp parallel for schedule(static, 1)
+    for (int b = 0; b < B; b++) {
+        std::vector<Vertex> scratch;
+        int begin = (int) ((int64_t) n * b / B);
+        int end = (int) ((int64_t) n * (b + 1) / B);
+        for (int v = begin; v < end; v++)
+            for_each_segment_run(g, v, seg.segment_size, scratch,
+                [&](int s, const Vertex *first, const Vertex *last) {
+                    int64_t slot = slot_counts[(size_t) s * B + b]++;
+                    int64_t edge = edge_counts[(size_t) s * B + b];
+                    seg.dests[slot] = v;
+                    seg.edge_starts[slot] = edge;
+                    std::copy(first, last, seg.sources + edge);
+                    edge_counts[(size_t) s * B + b] = edge + (last - first);
+                });
+    }
+
+    free(slot_counts);
+    free(edge_counts);
+    return seg;
+}
+
+void free_pr_segments(pr_segments *seg)
+{
+    free(seg->dest_starts);
+    free(seg->dests);
+    free(seg->edge_starts);
+    free(seg->sources);
+}
+
+void pageRankSegmented(Graph g, const pr_segments *segments, double *solution, double damping, double convergence)
+{
+    int numNodes = num_nodes(g);
+    double equal_prob = 1.0 / numNodes;
+    const pr_segments &seg = *segments;
+
+    double *invOutDegree = (double *) malloc(numNodes * sizeof(double));
+    double *scoreOther = (double *) malloc(numNodes * sizeof(double));
+    double *contrib = (double *) malloc(numNodes * sizeof(double));
+    double *contribNext = (double *) malloc(numNodes * sizeof(double));
+    double *acc = (double *) malloc(numNodes * sizeof(double));
+
+    double deadSum = 0.0;
+    #pragma omp parallel for reduction(+:deadSum)
+    for (int i = 0; i < numNodes; ++i)
+    {
+        int totalOut = outgoing_size(g, i);
+        invOutDegree[i] = (totalOut > 0) ? 1.0 / totalOut : 0.0;
+        solution[i] = equal_prob;
+        contrib[i] = equal_prob * invOutDegree[i];
+        acc[i] = 0.0;
+        if (totalOut == 0)
+            deadSum += equal_prob;
+    }
+
+    double *score = solution;
+    double *scoreNew = scoreOther;
+
+    bool converge = false;
+
+    while (!converge)
+    {
+        #pragma omp parallel
+        for (int s = 0; s < seg.num_segments; s++) {
+            #pragma omp for schedule(dynamic, 256)
+            for (int64_t i = seg.dest_starts[s]; i < seg.dest_starts[s + 1]; i++) {
+                double sum = 0.0;
+                for (int64_t e = seg.edge_starts[i]; e < seg.edge_starts[i + 1]; e++)
+                    sum += contrib[seg.sources[e]];
+                acc[seg.dests[i]] += sum;
+            }
+        }
+
+        double base = (1.0 - damping) / numNodes + damping * deadSum / numNodes;
+        double globDiff = 0.0;
+        double deadSumNew = 0.0;
+
+        #pragma omp parallel for reduction(+:globDiff, deadSumNew)
+        for (int vi = 0; vi < numNodes; vi++) {
+            double value = (damping * acc[vi]) + base;
+            acc[vi] = 0.0;
+            scoreNew[vi] = value;
+            contribNext[vi] = value * invOutDegree[vi];
+            if (invOutDegree[vi] == 0.0)
+                deadSumNew += value;
+            globDiff += fabs(value - score[vi]);
+        }
+
+        std::swap(score, scoreNew);
+        std::swap(contrib, contribNext);
+        deadSum = deadSumNew;
+
+        converge = globDiff < convergence;
+    }
+
+    if (score != solution) {
+        #pragma omp parallel for
+        for (int i = 0; i < numNodes; i++)
+            solution[i] = score[i];
+    }
+
+    free(invOutDegree);
+    free(scoreOther);
+    free(contrib);
+    free(contribNext);
+    free(acc);
+}
+
+void pageRankSegmented(Graph g, double *solution, double damping, double convergence)
+{
+    // a single segment is the plain pull with extra copies
+    if (num_nodes(g) <= segment_vertices()) {
+        pageRankImpl(g, solution, damping, convergence, false);
+        return;
+    }
+
+    pr_segments seg = build_pr_segments(g);
+    pageRankSegmented(g, &seg, solution, damping, convergence);
+    free_pr_segments(&seg);
+}
+
+// Personalized PageRank for K teleport vectors in one sweep.  Per-vertex
+// arrays hold K values side by side (vertex-major), so the gather over
+// the in-edges of v reads K contiguous contributions per edge and the
+// inner loops over k vectorize.  Teleport entries are few; they are
+// grouped by vertex once and added to the rows they belong to, and mass
+// reaching dead ends is sent back along the teleport vector of its seed.
+void personalizedPageRank(Graph g, const teleport_vector *teleports, int K, double *solution,
+                          double damping, double convergence)
+{
+    int numNodes = num_nodes(g);
+    size_t width = K;
+
+    if (K < 1) {
+        fprintf(stderr, "personalizedPageRank: need at least one teleport vector\n");
+        exit(1);
+    }
+
+    // group the teleport entries by vertex, weights scaled to sum to 1
+    int *teleportStarts = (int *) calloc(numNodes + 1, sizeof(int));
+    int numEntries = 0;
+    for (int k = 0; k < K; k++) {
+        for (int e = 0; e < teleports[k].num_entries; e++) {
+            Vertex v = teleports[k].vertices[e];
+            if (v < 0 || v >= numNodes) {
+                fprintf(stderr, "personalizedPageRank: teleport vertex %d is not a vertex\n", v);
+                exit(1);
+            }
+            teleportStarts[v + 1]++;
+        }
+        numEntries += teleports[k].num_entries;
+    }
+    for (int v = 0; v < numNodes; v++)
+        teleportStarts[v + 1] += teleportStarts[v];
+
+    int *teleportSeed = (int *) malloc(sizeof(int) * std::max(numEntries, 1));
+    double *teleportWeight = (double *) malloc(sizeof(double) * std::max(numEntries, 1));
+    int *cursor = (int *) malloc(sizeof(int) * numNodes);
+    for (int v = 0; v < numNodes; v++)
+        cursor[v] = teleportStarts[v];
+
+    for (int k = 0; k < K; k++) {
+        const teleport_vector &t = teleports[k];
+        double total = 0.0;
+        for (int e = 0; e < t.num_entries; e++)
+            total += t.weights ? t.weights[e] : 1.0;
+        if (!(total > 0.0)) {
+            fprintf(stderr, "personalizedPageRank: teleport vector %d has no weight\n", k);
+            exit(1);
+        }
+        for (int e = 0; e < t.num_entries; e++) {
+            int slot = cursor[t.vertices[e]]++;
+            teleportSeed[slot] = k;
+            teleportWeight[slot] = (t.weights ? t.weights[e] : 1.0) / total;
+        }
+    }
+    free(cursor);
+
+    double *invOutDegree = (double *) malloc(numNodes * sizeof(double));
+    double *scoreOther = (double *) malloc(numNodes * width * sizeof(double));
+    double *contrib = (double *) malloc(numNodes * width * sizeof(double));
+    double *contribNext = (double *) malloc(numNodes * width * sizeof(double));
+    double *deadSum = (double *) calloc(K, sizeof(double));
+    double *deadSumNew = (double *) malloc(K * sizeof(double));
+    double *globDiff = (double *) malloc(K * sizeof(double));
+    double *scale = (double *) malloc(K * sizeof(double));
+
+    // start every seed from its teleport distribution
+    #pragma omp parallel for
+    for (int v = 0; v < numNodes; v++) {
+        int totalOut = outgoing_size(g, v);
+        invOutDegree[v] = (totalOut > 0) ? 1.0 / totalOut : 0.0;
+        double *row = solution + v * width;
+        for (size_t k = 0; k < width; k++)
+            row[k] = 0.0;
+        for (int e = teleportStarts[v]; e < teleportStarts[v + 1]; e++)
+            row[teleportSeed[e]] += teleportWeight[e];
+        for (size_t k = 0; k < width; k++)
+            contrib[v * width + k] = row[k] * invOutDegree[v];
+    }
+
+    for (int v = 0; v < numNodes; v++)
+        if (invOutDegree[v] == 0.0)
+            for (int e = teleportStarts[v]; e < teleportStarts[v + 1]; e++)
+                deadSum[teleportSeed[e]] += teleportWeight[e];
+
+    double *score = solution;
+    double *scoreNew = scoreOther;
+
+    bool converge = false;
+
+    while (!converge)
+    {
+        for (int k = 0; k < K; k++) {
+            scale[k] = (1.0 - damping) + damping * deadSum[k];
+            deadSumNew[k] = 0.0;
+            globDiff[k] = 0.0;
+        }
+
+        #pragma omp parallel
+        {
+            std::vector<double> acc(width);
+            std::vector<double> diff(width, 0.0);
+            std::vector<double> dead(width, 0.0);
+
+            #pragma omp for schedule(dynamic, 256) nowait
+            for (int vi = 0; vi < numNodes; vi++) {
+                double *sum = acc.data();
+
+                #pragma omp simd
+                for (size_t k = 0; k < width; k++)
+                    sum[k] = 0.0;
+
+                const Vertex *end = incoming_end(g, vi);
+                for (const Vertex *in = incoming_begin(g, vi); in != end; in++) {
+                    const double *c = contrib + *in * width;
+                    #pragma omp simd
+                    for (size_t k = 0; k < width; k++)
+                        sum[k] += c[k];
+                }
+
+                double *out = scoreNew + vi * width;
+                #pragma omp simd
+                for (size_t k = 0; k < width; k++)
+                    out[k] = damping * sum[k];
+
+                for (int e = teleportStarts[vi]; e < teleportStarts[vi + 1]; e++)
+                    out[teleportSeed[e]] += scale[teleportSeed[e]] * teleportWeight[e];
+
+                const double *old = score + vi * width;
+                double *next = contribNext + vi * width;
+                double inv = invOutDegree[vi];
+                double *d = diff.data();
+
+                #pragma omp simd
+                for (size_t k = 0; k < width; k++) {
+                    next[k] = out[k] * inv;
+                    d[k] += fabs(out[k] - old[k]);
+                }
+
+                if (inv == 0.0) {
+                    for (size_t k = 0; k < width; k++)
+                        dead[k] += out[k];
+                }
+            }
+
+            #pragma omp critical
+            for (int k = 0; k < K; k++) {
+                globDiff[k] += diff[k];
+                deadSumNew[k] += dead[k];
+            }
+        }
+
+        std::swap(score, scoreNew);
+        std::swap(contrib, contribNext);
+        std::swap(deadSum, deadSumNew);
+
+        // done once every seed has converged
+        converge = true;
+        for (int k = 0; k < K; k++)
+            converge = converge && globDiff[k] < convergence;
+    }
+
+    if (score != solution) {
+        #pragma omp parallel for
+        for (size_t i = 0; i < numNodes * width; i++)
+            solution[i] = score[i];
+    }
+
+    free(teleportStarts);
+    free(teleportSeed);
+    free(teleportWeight);
+    free(invOutDegree);
+    free(scoreOther);
+    free(contrib);
+    free(contribNext);
+    free(deadSum);
+    free(deadSumNew);
+    free(globDiff);
+    free(scale);
+}
+
+// Warm start from prior scores after the edges in delta changed.  The
+// prior scores have (up to the old convergence threshold) no residual on
+// the old graph, so the residual on the new one is what the changed
+// sources now send differently: d * prior[u] / outdeg(u) to each new
+// out-neighbor minus the same with the old degree to each old one, or
+// spread over all vertices where u is (or was) a dead end.  Only those
+// entries are set before handing over to residualPageRank.
+void pageRankIncremental(Graph g, const graph_delta *delta, const double *prior, double *solution,
+                         double damping, double convergence)
+{
+    int numNodes = num_nodes(g);
+
+    for (int i = 0; i < delta->num_inserted + delta->num_removed; i++) {
+        const edge_change &e = (i < delta->num_inserted) ? delta->inserted[i]
+                                                         : delta->removed[i - delta->num_inserted];
+        if (e.src < 0 || e.src >= numNodes || e.dst < 0 || e.dst >= numNodes) {
+            fprintf(stderr, "pageRankIncremental: edge %d -> %d is not in a graph of %d vertices\n",
+                    e.src, e.dst, numNodes);
+            exit(1);
+        }
+    }
+
+    int *inserted = (int *) calloc(numNodes, sizeof(int));
+    int *removed = (int *) calloc(numNodes, sizeof(int));
+    double *residual = (double *) calloc(numNodes, sizeof(double));
+    std::vector<Vertex> sources;
+
+    for (int i = 0; i < delta->num_inserted; i++) {
+        Vertex u = delta->inserted[i].src;
+        if (inserted[u]++ == 0 && removed[u] == 0)
+            sources.push_back(u);
+    }
+    for (int i = 0; i < delta->num_removed; i++) {
+        Vertex u = delta->removed[i].src;
+        if (removed[u]++ == 0 && inserted[u] == 0)
+            sources.push_back(u);
+    }
+
+    double uniform = 0.0;
+
+    // new out-lists at the new degree, minus the old out-lists (new list
+    // without the inserted edges, plus the removed ones) at the old one
+    for (size_t i = 0; i < sources.size(); i++) {
+        Vertex u = sources[i];
+        int newDegree = outgoing_size(g, u);
+        int oldDegree = newDegree - inserted[u] + removed[u];
+        double mass = damping * prior[u];
+
+        if (oldDegree < 0) {
+            fprintf(stderr, "pageRankIncremental: delta does not match the graph at vertex %d\n", u);
+            exit(1);
+        }
+
+        double gained = (newDegree > 0) ? mass / newDegree : 0.0;
+        double lost = (oldDegree > 0) ? mass / oldDegree : 0.0;
+        if (newDegree == 0)
+            uniform += mass / numNodes;
+        if (oldDegree == 0)
+            uniform -= mass / numNodes;
+
+        const Vertex *end = outgoing_end(g, u);
+        for (const Vertex *v = outgoing_begin(g, u); v != end; v++)
+            residual[*v] += gained - lost;
+    }
+
+    for (int i = 0; i < delta->num_inserted; i++) {
+        Vertex u = delta->inserted[i].src;
+        int oldDegree = outgoing_size(g, u) - inserted[u] + removed[u];
+        if (oldDegree > 0)
+            residual[delta->inserted[i].dst] += damping * prior[u] / oldDegree;
+    }
+    for (int i = 0; i < delta->num_removed; i++) {
+        Vertex u = delta->removed[i].src;
+        int oldDegree = outgoing_size(g, u) - inserted[u] + removed[u];
+        residual[delta->removed[i].dst] -= damping * prior[u] / oldDegree;
+    }
+
+    #pragma omp parallel for
+    for (int v = 0; v < numNodes; v++)
+        solution[v] = prior[v];
+
+    free(inserted);
+    free(removed);
+
+    residualPageRank(g, solution, residual, uniform, damping, convergence);
+
+    free(residual);
+}
@@ -2,7 +2,88 @@
 #define __PAGE_RANK_H__
 
 #include "common/graph.h"
+#include "common/compressed_graph.h"
 
 void pageRank(Graph g, double* solution, double damping, double convergence);
+void pageRank(CompressedGraph g, double* solution, double damping, double convergence);
+
+// pageRank storing scores as T (float or double).  Per-vertex sums and
+// the convergence test are computed in double; compensated turns the
+// L1 change into Kahan sums.  Instantiated for float and double.
+template <typename T>
+void pageRank(Graph g, T* solution, double damping, double convergence, bool compensated = false);
+
+// Same fixed point and stopping rule as pageRank, computed on residuals:
+// pull sweeps while many vertices still change, then push rounds from a
+// worklist of the vertices that do (see page_rank.cpp).
+void pageRankPushPull(Graph g, double* solution, double damping, double convergence);
+void pageRankPushPull(CompressedGraph g, double* solution, double damping, double convergence);
+
+// Edges inserted into and removed from a graph, for pageRankIncremental.
+struct edge_change
+{
+    Vertex src;
+    Vertex dst;
+};
+
+struct graph_delta
+{
+    int num_inserted;
+    const edge_change* inserted;
+    int num_removed;
+    const edge_change* removed;
+};
+
+// PageRank of g restarted from prior, the converged scores (same
+// damping, same vertices) of the graph g was before delta was applied.
+// Only the residual the changed edges cause is propagated, so the work
+// follows the size of the change.  prior and solution may alias.
+// Every edge in delta must join two vertices of g.
+void pageRankIncremental(Graph g, const graph_delta* delta, const double* prior, double* solution,
+                         double damping, double convergence);
+
+// Sparse teleport distribution for personalized PageRank: num_entries
+// vertices with their weights, normalized to sum to 1.  weights may be
+// NULL for a uniform seed set.
+struct teleport_vector
+{
+    int num_entries;
+    const Vertex* vertices;
+    const double* weights;
+};
+
+// Personalized PageRank for K teleport vectors in one sweep over the
+// graph.  solution has num_nodes * K entries, vertex-major:
+// solution[v * K + k] is the score of v for teleports[k].  Mass reaching
+// dead ends returns along the teleport vector of its seed.  Iterates
+// until every seed's L1 change is below convergence.
+void personalizedPageRank(Graph g, const teleport_vector* teleports, int K, double* solution,
+                          double damping, double convergence);
+
+// In-edges grouped by cache-sized segments of source vertices (see
+// page_rank.cpp).  Building costs about two PageRank sweeps; keep one
+// around to run several PageRanks on the same graph.
+struct pr_segments
+{
+    int num_segments;
+    int segment_size;
+
+    // segment s covers the slots dest_starts[s] .. dest_starts[s + 1];
+    // slot i gathers sources[edge_starts[i] .. edge_starts[i + 1]) into
+    // dests[i].  Slots of a segment are in vertex order.
+    int64_t* dest_starts;
+    Vertex* dests;
+    int64_t* edge_starts;
+    Vertex* sources;
+};
+
+pr_segments build_pr_segments(Graph g);
+void free_pr_segments(pr_segments* segments);
+
+// pageRank over segmented in-edges, for graphs whose score arrays do
+// not fit in cache.  The first form builds (and frees) the segments,
+// or runs pageRank if the graph fits in one.
+void pageRankSegmented(Graph g, double* solution, double damping, double convergence);
+void pageRankSegmented(Graph g, const pr_segments* segments, double* solution, double damping, double convergence);
 
 #endif /* __PAGE_RANK_H__ */
@@ -0,0 +1,141 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <omp.h>
+#include <string>
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "common/CycleTimer.h"
+#include "common/graph.h"
+#include "sssp.h"
+
+#define SOURCE_NODE_ID 0
+
+int main(int argc, char** argv) {
+
+    if (argc < 2)
+    {
+        std::cerr << "Usage: <path/to/graph/file> [num_threads] [delta]\n";
+        std::cerr << "  To run results for all thread counts: <path/to/graph/file>\n";
+        std::cerr << "  Run with a certain number of threads: <path/to/graph/file> <num_threads>\n";
+        std::cerr << "  Unweighted graphs use weight 1 on every edge (see graphTools weights).\n";
+        exit(1);
+    }
+
+    int thread_count = -1;
+    if (argc >= 3)
+    {
+        thread_count = atoi(argv[2]);
+    }
+
+    printf("----------------------------------------------------------\n");
+    printf("Max system threads = %d\n", omp_get_max_threads());
+    if (thread_count > 0)
+    {
+        thread_count = std::min(thread_count, omp_get_max_threads());
+        printf("Running with %d threads\n", thread_count);
+    }
+    printf("----------------------------------------------------------\n");
+
+    printf("Loading graph...\n");
+    Graph g = load_graph_mmap(argv[1]);
+    printf("\n");
+    printf("Graph stats:\n");
+    printf("  Edges: %lld\n", (long long) g->num_edges);
+    printf("  Nodes: %d\n", g->num_nodes);
+    printf("  Weighted: %s\n", g->outgoing_weights ? "yes" : "no");
+
+    if (g->num_nodes == 0)
+    {
+        std::cerr << "Graph has no vertices.\n";
+        exit(1);
+    }
+
+    int64_t delta = (argc >= 4) ? atoll(argv[3]) : sssp_default_delta(g);
+    if (delta <= 0)
+    {
+        std::cerr << "Delta must be positive.\n";
+        exit(1);
+    }
+    printf("  Delta: %lld\n", (long long) delta);
+
+    std::vector<int> num_threads;
+    if (thread_count <= -1)
+    {
+        int max_threads = omp_get_max_threads();
+        for (int i = 1; i < max_threads; i *= 2) {
+          num_threads.push_back(i);
+        }
+        num_threads.push_back(max_threads);
+    }
+    else
+    {
+        num_threads.push_back(thread_count);
+    }
+    int n_usage = num_threads.size();
+
+    int64_t* expected = (int64_t*)malloc(sizeof(int64_t) * g->num_nodes);
+    int64_t* distances = (int64_t*)malloc(sizeof(int64_t) * g->num_nodes);
+
+    double start = CycleTimer::currentSeconds();
+    sssp_dijkstra(g, SOURCE_NODE_ID, expected);
+    double serial_time = CycleTimer::currentSeconds() - start;
+
+    int reached = 0;
+    for (int j=0; j<g->num_nodes; j++)
+        if (expected[j] != SSSP_INFINITY)
+            reached++;
+    printf("  Reached from %d: %d\n", SOURCE_NODE_ID, reached);
+
+    double base = 0, time;
+    bool check = true;
+
+    std::stringstream timing;
+    timing << "Threads  Delta-stepping     Speedup vs. Dijkstra\n";
+
+    for (int i = 0; i < n_usage; i++)
+    {
+        printf("----------------------------------------------------------\n");
+        std::cout << "Running with " << num_threads[i] << " threads" << std::endl;
+        omp_set_num_threads(num_threads[i]);
+
+        start = CycleTimer::currentSeconds();
+        sssp_delta_stepping(g, SOURCE_NODE_ID, delta, distances);
+        time = CycleTimer::currentSeconds() - start;
+
+        std::cout << "Testing Correctness of Delta-stepping\n";
+        for (int j=0; j<g->num_nodes; j++) {
+            if (distances[j] != expected[j]) {
+                fprintf(stderr, "*** Results disagree at %d: %lld, %lld\n", j,
+                        (long long) distances[j], (long long) expected[j]);
+                check = false;
+                break;
+            }
+        }
+
+        if (i == 0)
+            base = time;
+
+        char buf[1024];
+        sprintf(buf, "%4d:    %.2f (%.2fx)      %14.2f\n",
+                num_threads[i], time, base/time, serial_time/time);
+        timing << buf;
+    }
+
+    printf("----------------------------------------------------------\n");
+    std::cout << "Timing Summary" << std::endl;
+    std::cout << timing.str();
+    printf("----------------------------------------------------------\n");
+    std::cout << "Correctness: " << std::endl;
+    if (!check)
+        std::cout << "Delta-stepping is not Correct" << std::endl;
+    printf("Serial Dijkstra baseline: %.2f\n", serial_time);
+
+    free(distances);
+    free(expected);
+    free_graph(g);
+
+    return 0;
+}
@@ -0,0 +1,188 @@
+#include "sssp.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <omp.h>
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+using namespace std;
+#include "../common/graph.h"
+
+// Bucket index meaning "no bucket left".
+#define NO_BUCKET ((size_t) -1 / 2)
+
+static inline Weight edge_weight(Graph graph, EdgeIndex edge)
+{
+    return graph->outgoing_weights ? graph->outgoing_weights[edge] : 1;
+}
+
+void sssp_dijkstra(Graph graph, Vertex source, int64_t *distances)
+{
+    int n = num_nodes(graph);
+    for (int i = 0; i < n; i++)
+        distances[i] = SSSP_INFINITY;
+
+    typedef pair<int64_t, Vertex> entry;
+    priority_queue<entry, vector<entry>, greater<entry>> heap;
+
+    distances[source] = 0;
+    heap.push(entry(0, source));
+    while (!heap.empty())
+    {
+        entry top = heap.top();
+        heap.pop();
+        Vertex u = top.second;
+        if (top.first > distances[u])
+            continue;
+
+        EdgeIndex edge = graph->outgoing_starts[u];
+        for (const Vertex *v = outgoing_begin(graph, u); v != outgoing_end(graph, u); v++, edge++)
+        {
+            int64_t new_distance = top.first + edge_weight(graph, edge);
+            if (new_distance < distances[*v])
+            {
+                distances[*v] = new_distance;
+                heap.push(entry(new_distance, *v));
+            }
+        }
+    }
+}
+
+int64_t sssp_default_delta(Graph graph)
+{
+    int n = num_nodes(graph);
+    EdgeIndex m = num_edges(graph);
+    if (n == 0 || m == 0 || !graph->outgoing_weights)
+        return 1;
+
+    int64_t total = 0;
+    #pragma omp parallel for reduction(+ : total)
+    for (EdgeIndex e = 0; e < m; e++)
+        total += graph->outgoing_weights[e];
+
+    // (total / m) / (m / n)
+    return max<int64_t>(1, (int64_t)((double) total * n / ((double) m * m)));
+}
+
+// Lowers the distance of every out-neighbor of u that u improves and
+// files it under its new bucket in the calling thread's bins.
+static inline void relax_edges(Graph graph, Vertex u, int64_t delta, int64_t *distances,
+                               vector<vector<Vertex>> &bins)
+{
+    int64_t base = distances[u];
+    EdgeIndex edge = graph->outgoing_starts[u];
+    for (const Vertex *v = outgoing_begin(graph, u); v != outgoing_end(graph, u); v++, edge++)
+    {
+        int64_t new_distance = base + edge_weight(graph, edge);
+        int64_t old_distance = distances[*v];
+        while (new_distance < old_distance)
+        {
+            if (__sync_bool_compare_and_swap(&distances[*v], old_distance, new_distance))
+            {
+                size_t bin = new_distance / delta;
+                if (bin >= bins.size())
+                    bins.resize(bin + 1);
+                bins[bin].push_back(*v);
+                break;
+            }
+            old_distance = distances[*v];
+        }
+    }
+}
+
+// Two frontiers alternate between rounds: one is read while the next
+// non-empty bucket of every thread is copied into the other.  A vertex
+// can sit in a frontier more than once, or after its distance dropped
+// into an earlier bucket; such stale entries are skipped.  Threads
+// reserve their range of the next frontier before copying, so it can be
+// grown in between.
+void sssp_delta_stepping(Graph graph, Vertex source, int64_t delta, int64_t *distances)
+{
+    int n = num_nodes(graph);
+
+    #pragma omp parallel for
+    for (int i = 0; i < n; i++)
+        distances[i] = SSSP_INFINITY;
+    distances[source] = 0;
+
+    EdgeIndex capacities[2] = {max(n, 1), max(n, 1)};
+    Vertex *frontiers[2] = {(Vertex *)malloc(sizeof(Vertex) * capacities[0]),
+                            (Vertex *)malloc(sizeof(Vertex) * capacities[1])};
+
+    size_t shared_bins[2] = {0, NO_BUCKET};
+    EdgeIndex frontier_tails[2] = {1, 0};
+    frontiers[0][0] = source;
+
+    #pragma omp parallel
+    {
+        vector<vector<Vertex>> bins;
+        size_t round = 0;
+
+        while (shared_bins[round & 1] != NO_BUCKET)
+        {
+            size_t &curr_bin = shared_bins[round & 1];
+            size_t &next_bin = shared_bins[(round + 1) & 1];
+            EdgeIndex &curr_tail = frontier_tails[round & 1];
+            EdgeIndex &next_tail = frontier_tails[(round + 1) & 1];
+            Vertex *curr = frontiers[round & 1];
+
+            #pragma omp for nowait schedule(dynamic, 64)
+            for (EdgeIndex i = 0; i < curr_tail; i++)
+            {
+                Vertex u = curr[i];
+                if (distances[u] >= delta * (int64_t)curr_bin)
+                    relax_edges(graph, u, delta, distances, bins);
+            }
+
+            // the current bucket may have refilled through light edges,
+            // so the search for the next one starts at it
+            for (size_t b = curr_bin; b < bins.size(); b++)
+            {
+                if (!bins[b].empty())
+                {
+                    size_t seen = next_bin;
+                    while (b < seen && !__sync_bool_compare_and_swap(&next_bin, seen, b))
+                        seen = next_bin;
+                    break;
+                }
+            }
+
+            #pragma omp barrier
+
+            EdgeIndex at = 0;
+            bool merge = next_bin < bins.size() && !bins[next_bin].empty();
+            if (merge)
+                at = __sync_fetch_and_add(&next_tail, (EdgeIndex)bins[next_bin].size());
+
+            #pragma omp barrier
+            #pragma omp single
+            {
+                curr_bin = NO_BUCKET;
+                curr_tail = 0;
+                EdgeIndex &capacity = capacities[(round + 1) & 1];
+                if (next_tail > capacity)
+                {
+                    capacity = max(next_tail, 2 * capacity);
+                    free(frontiers[(round + 1) & 1]);
+                    frontiers[(round + 1) & 1] = (Vertex *)malloc(sizeof(Vertex) * capacity);
+                }
+            }
+
+            if (merge)
+            {
+                vector<Vertex> &bin = bins[next_bin];
+                copy(bin.begin(), bin.end(), frontiers[(round + 1) & 1] + at);
+                bin.clear();
+            }
+
+            round++;
+            #pragma omp barrier
+        }
+    }
+
+    free(frontiers[0]);
+    free(frontiers[1]);
+}
@@ -0,0 +1,29 @@
+#ifndef __SSSP_H__
+#define __SSSP_H__
+
+#include <stdint.h>
+
+#include "common/graph.h"
+
+// Distance of vertices the source does not reach.
+#define SSSP_INFINITY (INT64_MAX / 2)
+
+// Single-source shortest paths along outgoing edges.  Edge weights come
+// from g->outgoing_weights and must be non-negative; an unweighted
+// graph has weight 1 on every edge.  distances has num_nodes entries.
+
+// Serial Dijkstra with a binary heap; the baseline the parallel kernel
+// is checked against.
+void sssp_dijkstra(Graph graph, Vertex source, int64_t* distances);
+
+// Delta-stepping: vertices are settled in buckets of width delta, and
+// all vertices of the current bucket relax their edges in parallel
+// until the bucket stays empty.  Threads keep their own bucket lists and
+// only merge the next non-empty bucket into the shared frontier.
+void sssp_delta_stepping(Graph graph, Vertex source, int64_t delta, int64_t* distances);
+
+// Bucket width for sssp_delta_stepping: the average edge weight divided
+// by the average out-degree, at least 1.
+int64_t sssp_default_delta(Graph graph);
+
+#endif
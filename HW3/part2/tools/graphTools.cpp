@@ -1,6 +1,9 @@
 
 #include <algorithm>
 #include <climits>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <string>
@@ -8,26 +11,278 @@
 
 
 #include "../common/graph.h"
+#include "../common/compressed_graph.h"
+#include "../common/graph_generator.h"
+#include "../common/graph_reorder.h"
 
 #define CMD_TEXT2BIN    "text2bin"
+#define CMD_BIN2MAPPED  "bin2mapped"
+#define CMD_COMPRESS    "compress"
 #define CMD_INFO        "info"
 #define CMD_PRINT       "print"
 #define CMD_NOOUTEDGES  "noout"
 #define CMD_NOINEDGES   "noin"
 #define CMD_EDGESTATS   "edgestats"
+#define CMD_REORDER     "reorder"
+#define CMD_GENERATE    "generate"
+#define CMD_WEIGHTS     "weights"
 
 
+// Degree histograms have one bucket for degree 0 and bucket k >= 1 for
+// degrees in [2^(k-1), 2^k).
+#define DEGREE_BUCKETS 33
+
+static inline int degree_bucket(int degree)
+{
+    int bucket = 0;
+    while (degree > 0) {
+        degree >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+struct degree_stats
+{
+    int64_t total;
+    int min;
+    int max;
+    int64_t zero;
+    int64_t histogram[DEGREE_BUCKETS];
+};
+
+struct edge_stats
+{
+    degree_stats outgoing;
+    degree_stats incoming;
+    int64_t self_loops;
+    int64_t duplicate_edges;
+    int64_t asymmetric_edges;
+};
+
+// One side of the CSR with every neighbor list sorted.  Lists that are
+// sorted already (incoming lists always are) are used in place;
+// otherwise the whole side is copied and sorted once, so every check
+// below is a binary search or a merge instead of a linear scan.
+struct sorted_lists
+{
+    const EdgeIndex* starts;
+    const Vertex* edges;
+    Vertex* copy;
+    int num_nodes;
+    EdgeIndex num_edges;
+
+    const Vertex* begin(Vertex v) const { return edges + starts[v]; }
+    const Vertex* end(Vertex v) const
+    {
+        return edges + ((v == num_nodes - 1) ? num_edges : starts[v + 1]);
+    }
+};
+
+static sorted_lists sort_lists(const Graph g, const EdgeIndex* starts, const Vertex* edges)
+{
+    sorted_lists s;
+    s.starts = starts;
+    s.edges = edges;
+    s.copy = NULL;
+    s.num_nodes = num_nodes(g);
+    s.num_edges = num_edges(g);
+
+    bool sorted = true;
+    #pragma omp parallel for schedule(dynamic, 1024) reduction(&&:sorted)
+    for (int v = 0; v < s.num_nodes; v++)
+        sorted = sorted && std::is_sorted(s.begin(v), s.end(v));
+
+    if (sorted)
+        return s;
+
+    s.copy = (Vertex*)malloc(sizeof(Vertex) * std::max<EdgeIndex>(s.num_edges, 1));
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (int v = 0; v < s.num_nodes; v++) {
+        Vertex* out = s.copy + (s.begin(v) - edges);
+        std::copy(s.begin(v), s.end(v), out);
+        std::sort(out, out + (s.end(v) - s.begin(v)));
+    }
+    s.edges = s.copy;
+    return s;
+}
+
+static void init_degree_stats(degree_stats* d)
+{
+    memset(d, 0, sizeof(*d));
+    d->min = INT_MAX;
+}
+
+static void add_degree(degree_stats* d, int degree)
+{
+    d->total += degree;
+    d->min = std::min(d->min, degree);
+    d->max = std::max(d->max, degree);
+    d->zero += (degree == 0);
+    d->histogram[degree_bucket(degree)]++;
+}
+
+static void merge_degree_stats(degree_stats* into, const degree_stats* from)
+{
+    into->total += from->total;
+    into->min = std::min(into->min, from->min);
+    into->max = std::max(into->max, from->max);
+    into->zero += from->zero;
+    for (int b = 0; b < DEGREE_BUCKETS; b++)
+        into->histogram[b] += from->histogram[b];
+}
+
+// Gathers edge_stats in one parallel pass over the vertices, with
+// per-thread partial stats merged at the end.  Exits with a message
+// naming the lowest offending vertex if some edge i->t has no matching
+// incoming edge at t.
+static edge_stats compute_edge_stats(const Graph g)
+{
+    int n = num_nodes(g);
+    sorted_lists out = sort_lists(g, g->outgoing_starts, g->outgoing_edges);
+    sorted_lists in = sort_lists(g, g->incoming_starts, g->incoming_edges);
+
+    edge_stats stats;
+    init_degree_stats(&stats.outgoing);
+    init_degree_stats(&stats.incoming);
+    stats.self_loops = 0;
+    stats.duplicate_edges = 0;
+    stats.asymmetric_edges = 0;
+
+    Vertex bad_source = n;
+    Vertex bad_target = 0;
+
+    #pragma omp parallel
+    {
+        edge_stats local;
+        init_degree_stats(&local.outgoing);
+        init_degree_stats(&local.incoming);
+        local.self_loops = 0;
+        local.duplicate_edges = 0;
+        local.asymmetric_edges = 0;
+        Vertex local_bad_source = n;
+        Vertex local_bad_target = 0;
+
+        #pragma omp for schedule(dynamic, 1024) nowait
+        for (int i = 0; i < n; i++) {
+            add_degree(&local.outgoing, outgoing_size(g, i));
+            add_degree(&local.incoming, incoming_size(g, i));
+
+            const Vertex* out_begin = out.begin(i);
+            const Vertex* out_end = out.end(i);
+            const Vertex* in_it = in.begin(i);
+            const Vertex* in_end = in.end(i);
+
+            for (const Vertex* v = out_begin; v != out_end; v++) {
+                Vertex target = *v;
+
+                local.self_loops += (target == i);
+                if (v != out_begin && v[-1] == target)
+                    local.duplicate_edges++;
+
+                // sanity check: vertex i has an outgoing edge to
+                // target, so target better have an incoming edge from i
+                if (i < local_bad_source &&
+                    !std::binary_search(in.begin(target), in.end(target), i)) {
+                    local_bad_source = i;
+                    local_bad_target = target;
+                }
+
+                // symmetry test: both of i's sorted lists are walked
+                // together, looking for an incoming edge from target
+                while (in_it != in_end && *in_it < target)
+                    in_it++;
+                if (in_it == in_end || *in_it != target)
+                    local.asymmetric_edges++;
+            }
+        }
+
+        #pragma omp critical
+        {
+            merge_degree_stats(&stats.outgoing, &local.outgoing);
+            merge_degree_stats(&stats.incoming, &local.incoming);
+            stats.self_loops += local.self_loops;
+            stats.duplicate_edges += local.duplicate_edges;
+            stats.asymmetric_edges += local.asymmetric_edges;
+            if (local_bad_source < bad_source) {
+                bad_source = local_bad_source;
+                bad_target = local_bad_target;
+            }
+        }
+    }
+
+    free(out.copy);
+    free(in.copy);
+
+    if (bad_source < n) {
+        std::cerr << "GRAPH DID NOT PASS SANITY CHECK:\n"
+                  << "vertex " << bad_source << " has outgoing edge to " << bad_target << ",\n but "
+                  << "vertex " << bad_target << " has no incoming edge from " << bad_source << "\n";
+
+        // abort on a failed sanity check
+        exit(1);
+    }
+
+    return stats;
+}
+
+static void print_degree_json(std::ostream& os, const char* name, const degree_stats* d, int n)
+{
+    int last = 0;
+    for (int b = 0; b < DEGREE_BUCKETS; b++)
+        if (d->histogram[b])
+            last = b;
+
+    os << "  \"" << name << "\": {\n"
+       << "    \"total\": " << d->total << ",\n"
+       << "    \"avg\": " << (double) d->total / std::max(n, 1) << ",\n"
+       << "    \"min\": " << (n > 0 ? d->min : 0) << ",\n"
+       << "    \"max\": " << d->max << ",\n"
+       << "    \"zero_degree_vertices\": " << d->zero << ",\n"
+       << "    \"histogram\": [";
+    for (int b = 0; b <= last; b++) {
+        int64_t lo = (b == 0) ? 0 : (int64_t) 1 << (b - 1);
+        int64_t hi = (b == 0) ? 0 : ((int64_t) 1 << b) - 1;
+        os << (b ? ",\n" : "\n")
+           << "      {\"min_degree\": " << lo << ", \"max_degree\": " << hi
+           << ", \"vertices\": " << d->histogram[b] << "}";
+    }
+    os << "\n    ]\n  }";
+}
+
+static void print_edge_stats_json(std::ostream& os, const Graph g, const edge_stats* s)
+{
+    os << "{\n"
+       << "  \"num_vertices\": " << num_nodes(g) << ",\n"
+       << "  \"num_edges\": " << (int64_t) num_edges(g) << ",\n"
+       << "  \"csr_bytes\": " << 2 * (sizeof(EdgeIndex) * (int64_t) num_nodes(g) +
+                                      sizeof(Vertex) * (int64_t) num_edges(g)) << ",\n"
+       << "  \"symmetric\": " << (s->asymmetric_edges == 0 ? "true" : "false") << ",\n"
+       << "  \"asymmetric_edges\": " << s->asymmetric_edges << ",\n"
+       << "  \"self_loops\": " << s->self_loops << ",\n"
+       << "  \"duplicate_edges\": " << s->duplicate_edges << ",\n";
+    print_degree_json(os, "outgoing", &s->outgoing, num_nodes(g));
+    os << ",\n";
+    print_degree_json(os, "incoming", &s->incoming, num_nodes(g));
+    os << "\n}\n";
+}
+
 void print_help(const char* binary_name) {
     std::cerr << "Usage: " << binary_name << " cmd args\n";
     std::cerr << "Use '" << binary_name << " cmd' to get command-specific help.\n";
     std::cerr << "\n";
     std::cerr << "Valid cmds are:\n\n"
               << CMD_TEXT2BIN << ": text file to binary file conversion\n"
+              << CMD_BIN2MAPPED << ": binary file to memory-mappable binary file conversion\n"
+              << CMD_COMPRESS << ": binary file to compressed (delta + varint) binary file conversion\n"
               << CMD_INFO << ": print graph metadata\n"
               << CMD_PRINT << ": print graph topology (careful with big graphs)\n"
               << CMD_NOOUTEDGES << ": detect vertices with no outgoing edges\n"
               << CMD_NOINEDGES << ": detect vertices with no incoming edges\n"
-              << CMD_EDGESTATS << ": print stats on graph edges: e.g., min/max edges per node, etc.\n";
+              << CMD_EDGESTATS << ": print stats on graph edges: e.g., min/max edges per node, etc.\n"
+              << CMD_REORDER << ": relabel vertices for locality (degree, hub, rcm or gorder)\n"
+              << CMD_GENERATE << ": write a synthetic graph (rmat, uniform, grid2d or grid3d) as a binary file\n"
+              << CMD_WEIGHTS << ": add random integer edge weights to a binary file\n";
 }
 
 int main(int argc, char** argv) {
@@ -57,6 +312,173 @@ int main(int argc, char** argv) {
         store_graph_binary(outputFilename.c_str(), g);
         free_graph(g);
 
+    } else if (!cmd.compare(CMD_BIN2MAPPED)) {
+
+        if (argc < 4) {
+            std::cerr << "Usage: " << argv[0] << " " << cmd << " binfilename mappedfilename\n";
+            std::cerr << "Converts a graph from binary file format to the page-aligned format read by load_graph_mmap\n";
+            exit(1);
+        }
+
+        std::string inputFilename = std::string(argv[2]);
+        std::string outputFilename = std::string(argv[3]);
+
+        Graph g;
+        std::cout << "Loading graph: " << inputFilename << "\n";
+        g = load_graph_binary(inputFilename.c_str());
+        std::cout << "Done loading.\n";
+        store_graph_mapped(outputFilename.c_str(), g);
+        free_graph(g);
+
+    } else if (!cmd.compare(CMD_COMPRESS)) {
+
+        if (argc < 4) {
+            std::cerr << "Usage: " << argv[0] << " " << cmd << " binfilename compressedfilename\n";
+            std::cerr << "Converts a graph from binary file format to the compressed format read by load_compressed_graph\n";
+            exit(1);
+        }
+
+        std::string inputFilename = std::string(argv[2]);
+        std::string outputFilename = std::string(argv[3]);
+
+        Graph g;
+        std::cout << "Loading graph: " << inputFilename << "\n";
+        g = load_graph_binary(inputFilename.c_str());
+        std::cout << "Done loading.\n";
+
+        CompressedGraph cg = compress_graph(g);
+        double csr_bytes = 2.0 * (sizeof(EdgeIndex) * num_nodes(g) + sizeof(Vertex) * num_edges(g));
+        double compressed_bytes = compressed_graph_bytes(cg);
+        std::cout << "CSR bytes:        " << (size_t) csr_bytes << "\n";
+        std::cout << "Compressed bytes: " << (size_t) compressed_bytes
+                  << " (" << std::setprecision(3) << csr_bytes / compressed_bytes << "x smaller, "
+                  << compressed_bytes / std::max<double>(1, 2.0 * num_edges(g)) << " bytes/edge)\n";
+
+        store_compressed_graph(outputFilename.c_str(), cg);
+        free_compressed_graph(cg);
+        free_graph(g);
+
+    } else if (!cmd.compare(CMD_REORDER)) {
+
+        if (argc < 6) {
+            std::cerr << "Usage: " << argv[0] << " " << cmd << " degree|hub|rcm|gorder binfilename outbinfilename permfilename\n";
+            std::cerr << "Relabels the vertices of a binary graph and writes the relabeled binary graph.\n"
+                      << "Line v of the permutation file is the new id of original vertex v, so a result\n"
+                      << "computed on the relabeled graph maps back as result[v] = relabeled[new_id[v]].\n";
+            exit(1);
+        }
+
+        std::string methodName = std::string(argv[2]);
+        std::string inputFilename = std::string(argv[3]);
+        std::string outputFilename = std::string(argv[4]);
+        std::string permFilename = std::string(argv[5]);
+
+        reorder_method method;
+        if (!methodName.compare("degree"))
+            method = REORDER_DEGREE;
+        else if (!methodName.compare("hub"))
+            method = REORDER_HUB;
+        else if (!methodName.compare("rcm"))
+            method = REORDER_RCM;
+        else if (!methodName.compare("gorder"))
+            method = REORDER_GORDER;
+        else {
+            std::cerr << "Unknown reorder method: " << methodName << "\n";
+            exit(1);
+        }
+
+        Graph g;
+        std::cout << "Loading graph: " << inputFilename << "\n";
+        g = load_graph_binary(inputFilename.c_str());
+        std::cout << "Done loading. Now reordering graph...\n";
+
+        Vertex* new_id = reorder_permutation(g, method);
+        Graph relabeled = permute_graph(g, new_id);
+        store_graph_binary(outputFilename.c_str(), relabeled);
+
+        FILE* perm = fopen(permFilename.c_str(), "w");
+        if (!perm) {
+            std::cerr << "Could not open: " << permFilename << "\n";
+            exit(1);
+        }
+        for (int v = 0; v < num_nodes(g); v++)
+            fprintf(perm, "%d\n", new_id[v]);
+        fclose(perm);
+
+        free(new_id);
+        free_graph(relabeled);
+        free_graph(g);
+
+    } else if (!cmd.compare(CMD_GENERATE)) {
+
+        std::string kind = (argc > 2) ? std::string(argv[2]) : std::string();
+
+        generator_params params;
+        params.scale = 0;
+        params.num_vertices = 0;
+        params.edge_factor = 0;
+        params.dims[0] = params.dims[1] = params.dims[2] = 1;
+        params.seed = 0;
+        params.undirected = false;
+
+        std::string outputFilename;
+
+        if ((!kind.compare("rmat") || !kind.compare("uniform")) && argc >= 7) {
+            params.kind = !kind.compare("rmat") ? GENERATE_RMAT : GENERATE_UNIFORM;
+            params.scale = atoi(argv[3]);
+            params.num_vertices = atoi(argv[3]);
+            params.edge_factor = atoi(argv[4]);
+            params.seed = strtoull(argv[5], NULL, 10);
+            outputFilename = std::string(argv[6]);
+            params.undirected = (argc > 7 && !std::string(argv[7]).compare("undirected"));
+        } else if (!kind.compare("grid2d") && argc >= 6) {
+            params.kind = GENERATE_GRID;
+            params.dims[0] = atoi(argv[3]);
+            params.dims[1] = atoi(argv[4]);
+            outputFilename = std::string(argv[5]);
+        } else if (!kind.compare("grid3d") && argc >= 7) {
+            params.kind = GENERATE_GRID;
+            params.dims[0] = atoi(argv[3]);
+            params.dims[1] = atoi(argv[4]);
+            params.dims[2] = atoi(argv[5]);
+            outputFilename = std::string(argv[6]);
+        } else {
+            std::cerr << "Usage: " << argv[0] << " " << cmd << " rmat scale edgefactor seed binfilename [undirected]\n"
+                      << "       " << argv[0] << " " << cmd << " uniform numvertices edgefactor seed binfilename [undirected]\n"
+                      << "       " << argv[0] << " " << cmd << " grid2d width height binfilename\n"
+                      << "       " << argv[0] << " " << cmd << " grid3d width height depth binfilename\n";
+            std::cerr << "Writes a Graph500-style R-MAT graph (2^scale vertices), an Erdos-Renyi graph or a\n"
+                      << "grid graph in binary file format.  Self loops and duplicate edges are dropped.\n";
+            exit(1);
+        }
+
+        std::cout << "Generating graph...\n";
+        Graph g = generate_graph(&params);
+        std::cout << "Num vertices: " << num_nodes(g) << "\n";
+        std::cout << "Num edges:    " << num_edges(g) << "\n";
+        store_graph_binary(outputFilename.c_str(), g);
+        free_graph(g);
+
+    } else if (!cmd.compare(CMD_WEIGHTS)) {
+
+        if (argc < 6) {
+            std::cerr << "Usage: " << argv[0] << " " << cmd << " binfilename weightedfilename maxweight seed\n";
+            std::cerr << "Writes a copy of the graph with weights in [1, maxweight] on every edge.  Both\n"
+                      << "directions of an undirected edge get the same weight.\n";
+            exit(1);
+        }
+
+        std::string inputFilename = std::string(argv[2]);
+        std::string outputFilename = std::string(argv[3]);
+
+        Graph g;
+        std::cout << "Loading graph: " << inputFilename << "\n";
+        g = load_graph_binary(inputFilename.c_str());
+        std::cout << "Done loading. Now weighting graph...\n";
+        generate_weights(g, atoi(argv[4]), strtoull(argv[5], NULL, 10));
+        store_graph_binary(outputFilename.c_str(), g);
+        free_graph(g);
+
     } else if (!cmd.compare(CMD_INFO)) {
         if (argc < 3) {
             std::cerr << "Usage: " << argv[0] << " " << cmd << " filename\n";
@@ -73,6 +495,7 @@ int main(int argc, char** argv) {
 
         std::cout << "Num vertices: " << num_nodes(g) << "\n";
         std::cout << "Num edges:    " << num_edges(g) << "\n";
+        std::cout << "Weighted:     " << (g->outgoing_weights ? "yes" : "no") << "\n";
         free_graph(g);
 
     } else if (!cmd.compare(CMD_PRINT)) {
@@ -161,8 +584,9 @@ int main(int argc, char** argv) {
     } else if (!cmd.compare(CMD_EDGESTATS)) {
 
         if (argc < 3) {
-            std::cerr << "Usage: " << argv[0] << " " << cmd << " filename\n";
-            std::cerr << "Print basic stats about edges.\n";
+            std::cerr << "Usage: " << argv[0] << " " << cmd << " filename [jsonfilename]\n";
+            std::cerr << "Print basic stats about edges, and a JSON summary with log2 degree histograms\n"
+                      << "(to jsonfilename if given, otherwise after the stats).\n";
             exit(1);
         }
 
@@ -173,96 +597,37 @@ int main(int argc, char** argv) {
         g = load_graph_binary(inputFilename.c_str());
         std::cout << "Done loading. Now analyzing graph...\n";
 
-        unsigned int total_incoming = 0;
-        unsigned int total_outgoing = 0;
-        unsigned int min_outgoing = INT_MAX;
-        unsigned int max_outgoing = 0;
-        unsigned int min_incoming = INT_MAX;
-        unsigned int max_incoming = 0;
-        bool is_symmetric = true;
-
-        for (int i=0; i<num_nodes(g); i++) {
-
-            unsigned int num_incoming = incoming_size(g, i);
-            unsigned int num_outgoing = outgoing_size(g, i);
+        edge_stats stats = compute_edge_stats(g);
+        int n = num_nodes(g);
 
-            min_outgoing = std::min(min_outgoing, num_outgoing);
-            max_outgoing = std::max(max_outgoing, num_outgoing);
-            total_outgoing += num_outgoing;
-
-            min_incoming = std::min(min_incoming, num_incoming);
-            max_incoming = std::max(max_incoming, num_incoming);
-            total_incoming += num_incoming;
-
-            // check graph for sanity, and test for symmetric directed
-            // edges
-            const Vertex* out_begin = outgoing_begin(g, i);
-            const Vertex* out_end = outgoing_end(g, i);
-            for (const Vertex* v=out_begin; v!=out_end; v++) {
-
-                Vertex target = *v;
-
-                // sanity check. vertex i has an outoing edge to target
-                // (i->target), therefore target better have an
-                // incoming edge from i.
-                bool found_matching = false;
-                const Vertex* sanity_begin = incoming_begin(g, target);
-                const Vertex* sanity_end = incoming_end(g, target);
-                for (const Vertex* v2=sanity_begin; v2!=sanity_end; v2++) {
-                    Vertex i2 = *v2;
-                    if (i == i2) {
-                        found_matching = true;
-                        break;
-                    }
-                }
-                if (!found_matching) {
-                    std::cerr << "GRAPH DID NOT PASS SANITY CHECK:\n"
-                              << "vertex " << i << " has outgoing edge to " << target << ",\n but "
-                              << "vertex " << target << " has no incoming edge from " << i << "\n";
-
-                    // abort on a failed sanity check
-                    exit(1);
-                 }
-
-                // symmetry test: vertex i has an outgoing edge to
-                // target (i->target), so check to see if there's an
-                // incoming edge from target as well (target->i).
-                bool found_symmetric = false;
-                const Vertex* in_start = incoming_begin(g, i);
-                const Vertex* in_end =   incoming_end(g, i);
-
-                for (const Vertex* v2=in_start; v2!=in_end; v2++) {
-
-                    Vertex target2 = *v2;
-
-                    if (target == target2) {
-                        found_symmetric = true;
-                        break;
-                    }
-                }
-                if (!found_symmetric)
-                    is_symmetric = false;
-
-            }
-
-        }
-
-        float avg_outgoing = (float)total_outgoing / num_nodes(g);
-        float avg_incoming = (float)total_incoming / num_nodes(g);
+        float avg_outgoing = (float)stats.outgoing.total / n;
+        float avg_incoming = (float)stats.incoming.total / n;
 
         std::cout << "=========================================================\n";
         std::cout << "Edge statistics for this graph:\n";
         std::cout << "=========================================================\n";
-        std::cout << "The graph " << ((is_symmetric) ? "IS " : "IS NOT ") << "symmetric.\n";
-        std::cout << "Outgoing edges: total=" << total_outgoing
+        std::cout << "The graph " << ((stats.asymmetric_edges == 0) ? "IS " : "IS NOT ") << "symmetric.\n";
+        std::cout << "Outgoing edges: total=" << stats.outgoing.total
                   << " avg=" << avg_outgoing
-                  << " min=" << min_outgoing
-                  << " max=" << max_outgoing << "\n";
+                  << " min=" << stats.outgoing.min
+                  << " max=" << stats.outgoing.max << "\n";
 
-        std::cout << "Incoming edges: total=" << total_incoming
+        std::cout << "Incoming edges: total=" << stats.incoming.total
                   << " avg=" << avg_incoming
-                  << " min=" << min_incoming
-                  << " max=" << max_incoming << "\n";
+                  << " min=" << stats.incoming.min
+                  << " max=" << stats.incoming.max << "\n";
+
+        if (argc > 3) {
+            std::ofstream json(argv[3]);
+            if (!json) {
+                std::cerr << "Could not open: " << argv[3] << "\n";
+                exit(1);
+            }
+            print_edge_stats_json(json, g, &stats);
+        } else {
+            print_edge_stats_json(std::cout, g, &stats);
+        }
+        free_graph(g);
     }
 
     else {